@@ -3,6 +3,8 @@
 #include <imgui.h>
 
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
 
 #include "../basic.hpp"
 #include "../translate.hpp"
@@ -19,6 +21,8 @@ void Dynamics::draw() {
 		ImGui::Checkbox(tr("Inclined plane").c_str(),
 						&this->inclinedPlaneActive);
 		ImGui::Checkbox(tr("Cannon").c_str(), &this->cannonActive);
+		ImGui::Checkbox(tr("Parameter sweep").c_str(), &this->sweepActive);
+		ImGui::Checkbox(tr("Rigid bodies").c_str(), &this->bodiesActive);
 	}
 	ImGui::End();
 
@@ -135,6 +139,11 @@ void Dynamics::draw() {
 				ImGui::DragFloat(tr("Bullet radius").c_str(),
 								 &this->c.bulletSize, 0.01, 0.01, 32, "%.2f m",
 								 ImGuiSliderFlags_AlwaysClamp);
+				ImGui::Checkbox(tr("Collisions").c_str(),
+								&this->c.collisions);
+				ImGui::SliderFloat(tr("Restitution").c_str(),
+								   &this->c.restitution, 0.0f, 1.0f, "%.2f",
+								   ImGuiSliderFlags_AlwaysClamp);
 				ImGui::DragFloat(tr("Window scale").c_str(), &this->c.boxScale,
 								 0.1, 0.1, 1024, "%.1fpx = 1m",
 								 ImGuiSliderFlags_AlwaysClamp);
@@ -144,6 +153,9 @@ void Dynamics::draw() {
 		}
 		ImGui::End();
 	}
+
+	if (this->sweepActive) this->drawSweep();
+	if (this->bodiesActive) this->drawBodies();
 }
 
 void Dynamics::drawInclinedPlane() {
@@ -207,16 +219,13 @@ void Dynamics::drawCannonSimulation() {
 	ImGui::SetCursorPos(ImVec2(wSize.x - 200, cursorPos.y));
 	ImGui::Text(
 		(tr("Cannon speed") + ": %.1fm/s\n" + tr("Bullet mass") + ": %.1fkg\n" +
-		 tr("Bullet speed") + ": %.1fm/s\n")
+		 tr("Bullet speed") + ": %.1fm/s\n" + tr("Bullets") + ": %zu\n")
 			.c_str(),
 		std::sqrt(std::pow(this->c.move.x, 2) + std::pow(this->c.move.y, 2)),
-		this->c.currentBulletMass, this->c.currentBulletSpeed);
+		this->c.currentBulletMass, this->c.currentBulletSpeed,
+		this->c.bullets.size());
 
-	for (auto& bullet : this->c.bullets) {
-		draw->AddCircleFilled(bullet.position,
-							  this->c.bulletSize * this->c.boxScale,
-							  ImColor(70, 70, 70));
-	}
+	this->c.bullets.draw(draw, wPos, this->c.boxScale, this->c.bulletSize);
 
 	ImVec2 barrelPos =
 		this->drawCannon(ImVec2(this->c.position.x * this->c.boxScale + wPos.x,
@@ -256,16 +265,22 @@ void Dynamics::drawCannonSimulation() {
 				(this->c.position.y < posLimitY.x) ? posLimitY.x : posLimitY.y;
 		}
 
-		for (unsigned short bulletID = 0; bulletID < this->c.bullets.size();
-			 bulletID++) {
-			object& bullet = this->c.bullets[bulletID];
-			if (bullet.position.x < 0 || bullet.position.x > wSize.x ||
-				bullet.position.y < 0 || bullet.position.y > wSize.y) {
-				this->c.bullets.erase(this->c.bullets.begin() + bulletID);
-			}
-			bullet.move.y -= this->c.gravity * delta;
-			bullet.position.x += bullet.move.x * delta * this->c.boxScale;
-			bullet.position.y -= bullet.move.y * delta * this->c.boxScale;
+		this->c.bullets.update(delta, this->c.gravity);
+		ImVec2 box(wSize.x / this->c.boxScale, wSize.y / this->c.boxScale);
+		this->c.bullets.removeOutside(box);
+		if (this->c.collisions) {
+			// Body of cannon is circle as drawn by drawCannon
+			float r = this->c.bulletSize;
+			ImVec2 offset(std::sin(this->c.rotate) * 4 * r,
+						  std::cos(this->c.rotate) * 4 * r);
+			Dynamic::Obstacle body = {
+				ImVec2(this->c.position.x - offset.x,
+					   this->c.position.y - offset.y),
+				this->c.move, this->c.mass, 3 * r};
+			this->c.bullets.collide(r, this->c.restitution, body, box);
+			this->c.position = ImVec2(body.position.x + offset.x,
+									  body.position.y + offset.y);
+			this->c.move = body.move;
 		}
 
 		if (ImGui::IsKeyDown(ImGui::GetKeyIndex(ImGuiKey_UpArrow))) {
@@ -290,19 +305,334 @@ void Dynamics::drawCannonSimulation() {
 		 ImGui::IsKeyDown(ImGui::GetKeyIndex(ImGuiKey_Tab)) ||
 		 ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Space))) &&
 		ImGui::IsWindowFocused()) {
-		object bullet;
-		bullet.position = barrelPos;
-		bullet.mass = this->c.currentBulletMass;
-		bullet.move.x =
-			std::cos(this->c.barrelAngle) * this->c.currentBulletSpeed;
-		bullet.move.y =
-			std::sin(this->c.barrelAngle) * this->c.currentBulletSpeed;
-
-		float part = bullet.mass / this->c.mass;
-		this->c.move.x += -bullet.move.x * part;
-		this->c.move.y += -bullet.move.y * part;
-
-		this->c.bullets.push_back(bullet);
+		ImVec2 move(std::cos(this->c.barrelAngle) * this->c.currentBulletSpeed,
+					std::sin(this->c.barrelAngle) * this->c.currentBulletSpeed);
+		// Cannon recoils only when bullet found place in pool
+		if (this->c.bullets.add(
+				ImVec2((barrelPos.x - wPos.x) / this->c.boxScale,
+					   (barrelPos.y - wPos.y) / this->c.boxScale),
+				move, this->c.currentBulletMass)) {
+			float part = this->c.currentBulletMass / this->c.mass;
+			this->c.move.x += -move.x * part;
+			this->c.move.y += -move.y * part;
+		}
+	}
+}
+
+void Dynamics::drawSweep() {
+	Dynamic::Sweep& s = this->sweep;
+	ImGui::Begin((tr("Dynamic Laws") + " - " + tr("Parameter sweep")).c_str(),
+				 &this->sweepActive, ImGuiWindowFlags_MenuBar);
+	bool cannon = s.experiment == Dynamic::Sweep::cannonRange;
+	if (ImGui::BeginMenuBar()) {
+		if (ImGui::BeginMenu(tr("Options").c_str())) {
+			std::string range = tr("Range of cannon"),
+						time = tr("Time to bottom of plane");
+			const char* experiments[] = {range.c_str(), time.c_str()};
+			int experiment = s.experiment;
+			if (ImGui::Combo(tr("Experiment").c_str(), &experiment,
+							 experiments, IM_ARRAYSIZE(experiments)))
+				s.experiment = (Dynamic::Sweep::Experiment)experiment;
+			ImGui::DragInt(tr("Resolution").c_str(), &s.resolution, 1.0f, 8,
+						   512, "%d", ImGuiSliderFlags_AlwaysClamp);
+			if (cannon) {
+				ImGui::DragFloatRange2(tr("Angle").c_str(), &s.angle.min,
+									   &s.angle.max, 0.5f, 0.0f, 90.0f,
+									   "%.1f°", NULL,
+									   ImGuiSliderFlags_AlwaysClamp);
+				ImGui::DragFloatRange2(tr("Bullet speed").c_str(),
+									   &s.speed.min, &s.speed.max, 0.5f, 0.0f,
+									   4096.0f, "%.1f m/s", NULL,
+									   ImGuiSliderFlags_AlwaysClamp);
+				ImGui::DragFloat(tr("Air drag").c_str(), &s.drag, 1e-4f, 0.0f,
+								 1.0f, "%.4f 1/m",
+								 ImGuiSliderFlags_AlwaysClamp);
+			} else {
+				ImGui::DragFloatRange2(tr("Angle").c_str(), &s.inclination.min,
+									   &s.inclination.max, 0.5f, 0.0f, 90.0f,
+									   "%.1f°", NULL,
+									   ImGuiSliderFlags_AlwaysClamp);
+				ImGui::DragFloatRange2(tr("Friction ratio").c_str(),
+									   &s.friction.min, &s.friction.max, 0.01f,
+									   0.0f, 100.0f, "%.2f", NULL,
+									   ImGuiSliderFlags_AlwaysClamp);
+			}
+			ImGui::EndMenu();
+		}
+		ImGui::EndMenuBar();
+	}
+	// Gravity and plane come from their windows
+	s.gravity = cannon ? this->c.gravity : this->i.gravity;
+	s.distance = this->i.distance;
+	s.update();
+
+	ImVec2 origin = ImGui::GetCursorScreenPos(),
+		   size = ImGui::GetContentRegionAvail();
+	size.y -= 2 * ImGui::GetTextLineHeightWithSpacing();
+	size = ImVec2(std::max(size.x, 1.0f), std::max(size.y, 1.0f));
+	ImGui::InvisibleButton("##Sweep", size);
+	ImDrawList* draw = ImGui::GetWindowDrawList();
+	s.draw(draw, origin, size);
+
+	// Current values of experiment window
+	const Dynamic::Sweep::Range &xRange = s.xRange(), &yRange = s.yRange();
+	ImVec2 mark = cannon ? ImVec2(this->c.barrelAngle * 180 / M_PI,
+								  this->c.currentBulletSpeed)
+						 : ImVec2(this->i.inclination, this->i.frictionRatio);
+	draw->AddCircle(
+		ImVec2(origin.x + (mark.x - xRange.min) / (xRange.max - xRange.min) *
+							  size.x,
+			   origin.y + (yRange.max - mark.y) / (yRange.max - yRange.min) *
+							  size.y),
+		6.0f, ImColor(255, 255, 255), 0, 2.0f);
+
+	// Parameters under mouse, click moves experiment to them
+	if (ImGui::IsItemHovered()) {
+		ImVec2 m = ImGui::GetMousePos();
+		float tx = (m.x - origin.x) / size.x,
+			  ty = 1 - (m.y - origin.y) / size.y,
+			  x = xRange.min + tx * (xRange.max - xRange.min),
+			  y = yRange.min + ty * (yRange.max - yRange.min),
+			  v = s.valueAt(tx, ty);
+		if (cannon)
+			ImGui::SetTooltip("%.1f°, %.1f m/s: %.2f m", x, y, v);
+		else if (std::isfinite(v))
+			ImGui::SetTooltip("%.1f°, %.2f: %.2f s", x, y, v);
+		else
+			ImGui::SetTooltip("%.1f°, %.2f: %s", x, y,
+							  tr("Body does not slide").c_str());
+		if (ImGui::IsItemClicked()) {
+			if (cannon) {
+				this->c.barrelAngle = x * M_PI / 180;
+				this->c.currentBulletSpeed = y;
+			} else {
+				this->i.inclination = x;
+				this->i.frictionRatio = y;
+			}
+		}
+	}
+	if (cannon)
+		ImGui::Text("%s: %.1f° - %.1f°, %s: %.1f - %.1f m/s",
+					tr("Angle").c_str(), xRange.min, xRange.max,
+					tr("Bullet speed").c_str(), yRange.min, yRange.max);
+	else
+		ImGui::Text("%s: %.1f° - %.1f°, %s: %.2f - %.2f", tr("Angle").c_str(),
+					xRange.min, xRange.max, tr("Friction ratio").c_str(),
+					yRange.min, yRange.max);
+	ImGui::Text("%s: %.2f %s", tr("Largest value").c_str(), s.maxValue(),
+				cannon ? "m" : "s");
+	ImGui::End();
+}
+
+void Dynamics::drawBodies() {
+	ImGui::Begin((tr("Dynamic Laws") + " - " + tr("Rigid bodies")).c_str(),
+				 &this->bodiesActive, ImGuiWindowFlags_MenuBar);
+	ImVec2 wPos = ImGui::GetWindowPos(), wSize = ImGui::GetWindowSize();
+	float width = wSize.x / this->r.scale;
+	if (ImGui::BeginMenuBar()) {
+		if (ImGui::BeginMenu(tr("Options").c_str())) {
+			ImGui::DragFloat(tr("Window scale").c_str(), &this->r.scale, 0.1,
+							 1, 1024, "%.1fpx = 1m",
+							 ImGuiSliderFlags_AlwaysClamp);
+			ImGui::DragFloat(tr("Time speed").c_str(), &this->r.timeScale,
+							 0.5f, 0.001f, std::pow(2, 12), "%.2f : 1",
+							 ImGuiSliderFlags_AlwaysClamp |
+								 ImGuiSliderFlags_Logarithmic);
+			float gravity = -this->world.gravity.y;
+			if (ImGui::DragFloat(tr("Gravity").c_str(), &gravity, 0.1f, 0.0f,
+								 std::pow(2, 8), "%.1f m/s²",
+								 ImGuiSliderFlags_AlwaysClamp))
+				this->world.gravity.y = -gravity;
+			ImGui::DragInt(tr("Solver iterations").c_str(),
+						   &this->world.iterations, 0.2f, 1, 100, "%d",
+						   ImGuiSliderFlags_AlwaysClamp);
+			ImGui::Checkbox(tr("Warm starting").c_str(),
+							&this->world.warmStarting);
+			ImGui::Separator();
+			std::string box = tr("Box"), circle = tr("Circle"),
+						polygon = tr("Polygon");
+			const char* shapes[] = {box.c_str(), circle.c_str(),
+									polygon.c_str()};
+			ImGui::Combo(tr("Added by click").c_str(), &this->r.shape, shapes,
+						 IM_ARRAYSIZE(shapes));
+			ImGui::DragFloat(tr("Size").c_str(), &this->r.size, 0.01f, 0.05f,
+							 10.0f, "%.2f m", ImGuiSliderFlags_AlwaysClamp);
+			ImGui::DragFloat(tr("Friction ratio").c_str(), &this->r.friction,
+							 0.01f, 0.0f, 100.0f, "%.2f",
+							 ImGuiSliderFlags_AlwaysClamp);
+			ImGui::SliderFloat(tr("Restitution").c_str(),
+							   &this->r.restitution, 0.0f, 1.0f, "%.2f",
+							   ImGuiSliderFlags_AlwaysClamp);
+			ImGui::EndMenu();
+		}
+		if (ImGui::BeginMenu(tr("Scenes").c_str())) {
+			if (ImGui::MenuItem(tr("Stack").c_str())) buildStack(width);
+			if (ImGui::MenuItem(tr("Pyramid").c_str())) buildPyramid(width);
+			// Angle, length and friction come from inclined plane window
+			if (ImGui::MenuItem(tr("Blocks on slope").c_str()))
+				buildSlope(width);
+			if (ImGui::MenuItem(tr("Random bodies").c_str()))
+				buildRandom(width);
+			if (ImGui::MenuItem(tr("Remove all").c_str())) this->world.clear();
+			ImGui::EndMenu();
+		}
+		ImGui::EndMenuBar();
+	}
+	if (this->world.bodies().empty() && this->r.lastUpdate == 0)
+		buildStack(width);
+
+	// Ground lies at bottom of window, y goes up
+	auto toScreen = [&](const ImVec2& p) {
+		return ImVec2(wPos.x + p.x * this->r.scale,
+					  wPos.y + wSize.y - p.y * this->r.scale);
+	};
+	ImVec2 mousePos = ImGui::GetMousePos(),
+		   mouse((mousePos.x - wPos.x) / this->r.scale,
+				 (wPos.y + wSize.y - mousePos.y) / this->r.scale);
+
+	ImVec2 cursorPos = ImGui::GetCursorPos();
+	ImGui::InvisibleButton("##Bodies", ImVec2(std::max(wSize.x, 1.0f),
+											  std::max(wSize.y - cursorPos.y,
+													   1.0f)));
+	if (ImGui::IsItemClicked()) {
+		float s = this->r.size;
+		int i;
+		if (this->r.shape == 0) {
+			i = this->world.addBox(mouse, ImVec2(s, s), 0.0f, 1.0f);
+		} else if (this->r.shape == 1) {
+			i = this->world.addCircle(mouse, s, 1.0f);
+		} else {
+			// Regular pentagon
+			std::vector<ImVec2> vertices;
+			for (int k = 0; k < 5; k++)
+				vertices.push_back(ImVec2(s * std::cos(k * 2 * M_PI / 5),
+										  s * std::sin(k * 2 * M_PI / 5)));
+			i = this->world.addPolygon(mouse, vertices, 1.0f);
+		}
+		this->world.body(i).friction = this->r.friction;
+		this->world.body(i).restitution = this->r.restitution;
+	}
+
+	// Fixed steps, so result doesn't depend on frame rate
+	const float dt = 1.0f / 60;
+	double now = ImGui::GetTime(), delta = now - this->r.lastUpdate;
+	this->r.lastUpdate = now;
+	if (delta <= 1) this->r.accumulated += delta / this->r.timeScale;
+	auto start = std::chrono::steady_clock::now();
+	for (int n = 0; this->r.accumulated >= dt; n++) {
+		this->r.accumulated -= dt;
+		// Slow frames drop time instead of taking even longer
+		if (n < 4) this->world.step(dt);
+	}
+	this->r.stepTime = std::chrono::duration<float, std::milli>(
+						   std::chrono::steady_clock::now() - start)
+						   .count();
+
+	ImDrawList* draw = ImGui::GetWindowDrawList();
+	std::vector<ImVec2> points;
+	for (auto& b : this->world.bodies()) {
+		ImColor color = b.isStatic() ? ImColor(0, 64, 255)
+									 : ImColor(255, 0, 0),
+				outline(255, 255, 255, 120);
+		if (b.shape == Dynamic::Body::Shape::circle) {
+			ImVec2 center = toScreen(b.position);
+			float radius = b.radius * this->r.scale;
+			draw->AddCircleFilled(center, radius, color);
+			// Line shows rotation
+			draw->AddLine(center,
+						  ImVec2(center.x + std::cos(b.angle) * radius,
+								 center.y - std::sin(b.angle) * radius),
+						  outline, 2.0f);
+			continue;
+		}
+		points.clear();
+		for (size_t k = 0; k < b.vertices.size(); k++)
+			points.push_back(toScreen(b.worldVertex(k)));
+		draw->AddConvexPolyFilled(points.data(), points.size(), color);
+		draw->AddPolyline(points.data(), points.size(), outline,
+						  ImDrawFlags_Closed, 1.0f);
+	}
+
+	ImGui::SetCursorPos(ImVec2(wSize.x - 200, cursorPos.y));
+	ImGui::Text((tr("Bodies") + ": %zu\n" + tr("Contacts") + ": %zu\n" +
+				 tr("Tree height") + ": %d\n" + tr("Step time") + ": %.2f ms")
+					.c_str(),
+				this->world.bodies().size(), this->world.contacts(),
+				this->world.treeHeight(), this->r.stepTime);
+	ImGui::End();
+}
+
+void Dynamics::buildStack(float width) {
+	this->world.clear();
+	this->world.addBox(ImVec2(width / 2, -0.5f), ImVec2(width, 0.5f), 0, 0);
+	for (int i = 0; i < 10; i++) {
+		int b = this->world.addBox(ImVec2(width / 2, 0.5f + i),
+								   ImVec2(0.5f, 0.5f), 0, 1);
+		this->world.body(b).friction = this->r.friction;
+	}
+}
+
+void Dynamics::buildPyramid(float width) {
+	this->world.clear();
+	this->world.addBox(ImVec2(width / 2, -0.5f), ImVec2(width, 0.5f), 0, 0);
+	const int rows = 15;
+	for (int row = 0; row < rows; row++) {
+		for (int k = 0; k < rows - row; k++) {
+			int b = this->world.addBox(
+				ImVec2(width / 2 + (k - (rows - row - 1) / 2.0f) * 1.05f,
+					   0.5f + row),
+				ImVec2(0.5f, 0.5f), 0, 1);
+			this->world.body(b).friction = this->r.friction;
+		}
+	}
+}
+
+// Plane of inclined plane window, blocks start at rest one after another
+void Dynamics::buildSlope(float width) {
+	this->world.clear();
+	this->world.addBox(ImVec2(width / 2, -0.5f), ImVec2(width, 0.5f), 0, 0);
+	float angle = std::min(std::max(this->i.inclination, 1.0f), 80.0f) *
+				  M_PI / 180,
+		  length = this->i.distance;
+	ImVec2 top(1.0f, length * std::sin(angle)),
+		along(std::cos(angle), -std::sin(angle)),
+		normal(std::sin(angle), std::cos(angle));
+	int slope = this->world.addPolygon(
+		ImVec2(0, 0),
+		{ImVec2(top.x, 0), ImVec2(top.x + length * along.x, 0), top}, 0);
+	this->world.body(slope).friction = this->i.frictionRatio;
+	float half = std::min(0.25f, length / 10);
+	for (int k = 0; k < 3; k++) {
+		float s = (k * 3 + 1) * half;
+		int b = this->world.addBox(
+			ImVec2(top.x + along.x * s + normal.x * half,
+				   top.y + along.y * s + normal.y * half),
+			ImVec2(half, half), -angle, 1);
+		this->world.body(b).friction = this->i.frictionRatio;
+	}
+}
+
+void Dynamics::buildRandom(float width) {
+	this->world.clear();
+	this->world.addBox(ImVec2(width / 2, -0.5f), ImVec2(width, 0.5f), 0, 0);
+	// Walls keep bodies above ground
+	for (float x : {0.0f, width})
+		this->world.addBox(ImVec2(x, 20), ImVec2(0.2f, 20), 0, 0);
+	for (int k = 0; k < 300; k++) {
+		ImVec2 p(1 + std::fmod(k * 0.618034f * (width - 2), width - 2),
+				 1 + k * 0.15f);
+		float s = 0.2f + 0.2f * (rand() / (float)RAND_MAX);
+		int b;
+		if (k % 3 == 0) {
+			b = this->world.addCircle(p, s, 1);
+		} else if (k % 3 == 1) {
+			b = this->world.addBox(p, ImVec2(s, s * 0.7f), k * 0.7f, 1);
+		} else {
+			b = this->world.addPolygon(
+				p, {ImVec2(-s, -s), ImVec2(s, -s), ImVec2(0, s)}, 1);
+		}
+		this->world.body(b).friction = this->r.friction;
+		this->world.body(b).restitution = this->r.restitution;
 	}
 }
 
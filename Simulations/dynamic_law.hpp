@@ -6,6 +6,9 @@
 
 #include "../basic.hpp"
 #include "../view.hpp"
+#include "dynamic_law_bodies.hpp"
+#include "dynamic_law_bullets.hpp"
+#include "dynamic_law_sweep.hpp"
 
 class Dynamics : public View {
    public:
@@ -14,10 +17,20 @@ class Dynamics : public View {
 
    private:
 	ImGuiIO* io;
-	bool inclinedPlaneActive = false, cannonActive = false;
+	bool inclinedPlaneActive = false, cannonActive = false,
+		 sweepActive = false, bodiesActive = false;
+	Dynamic::Sweep sweep;
+	Dynamic::World world;
 	void drawSkateboard();
 	void drawInclinedPlane();
 	void drawCannonSimulation();
+	void drawSweep();
+	void drawBodies();
+	// Scenes of rigid bodies window, ground spans width in m
+	void buildStack(float width);
+	void buildPyramid(float width);
+	void buildSlope(float width);
+	void buildRandom(float width);
 	struct {
 		double lastRefresh;
 		float viewX, viewY, scale = 1.0f;
@@ -46,6 +59,8 @@ class Dynamics : public View {
 		float currentBulletMass = 1.0f;	   // Mass of bullet with can be shoted
 		float currentBulletSpeed = 20.0f;  // Speed of bullet with can be shoted
 		float bulletSize = 0.30f;		   // Radius of bullet
+		float restitution = 0.8f;  // Of collisions, 0 for sticking, 1 elastic
+		bool collisions = true;	   // Between bullets and with cannon
 		float barrelAngle = 0.0f;  // Angle of barrel. Helps to calculate angle
 								   // of force after shot
 		float boxScale = 50.0f;	   // Scale of window. boxScale pixels = 1 meter
@@ -54,8 +69,18 @@ class Dynamics : public View {
 		float lastUpdate;		  // Time of last values update
 		float secureMode = true;  // Allows to set negative mass and speed
 
-		std::vector<object> bullets;  // List with all bullets
+		Dynamic::Bullets bullets;  // All bullets, positions in m
 	} c;
+	struct {
+		float scale = 40.0f;  // scale px = 1m
+		int shape = 0;		  // Added by click: box, circle or polygon
+		float size = 0.5f;	  // Half side or radius of added body, in m
+		float friction = 0.5f, restitution = 0.1f;	// Of added bodies
+		float timeScale = 1.0f;	 // Time scaled by expr 1/timeScale
+		double accumulated = 0;	 // Time not simulated yet, in s
+		double lastUpdate = 0;
+		float stepTime = 0.0f;	// Of last frame, in ms
+	} r;
 	float heightOnSlope(
 		float angle,
 		float pos = 1.0f);	// Returns ratio between slope height and length
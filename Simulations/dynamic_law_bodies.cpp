@@ -0,0 +1,463 @@
+#include "dynamic_law_bodies.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+using namespace Dynamic;
+
+namespace {
+const float baumgarte = 0.2f;	 // Part of overlap removed per step
+const float slop = 0.01f;	 // Overlap left alone and gap of points kept, in m
+const float bounceSpeed = 1.0f;	 // Slower impacts don't bounce, in m/s
+const float matchDistance = 0.05f;	// Of points kept between steps, in m
+
+ImVec2 add(const ImVec2& a, const ImVec2& b) {
+	return ImVec2(a.x + b.x, a.y + b.y);
+}
+ImVec2 sub(const ImVec2& a, const ImVec2& b) {
+	return ImVec2(a.x - b.x, a.y - b.y);
+}
+ImVec2 mul(const ImVec2& a, float s) { return ImVec2(a.x * s, a.y * s); }
+float dot(const ImVec2& a, const ImVec2& b) { return a.x * b.x + a.y * b.y; }
+float cross(const ImVec2& a, const ImVec2& b) { return a.x * b.y - a.y * b.x; }
+// Velocity of point at r of body turning with w
+ImVec2 cross(float w, const ImVec2& r) { return ImVec2(-w * r.y, w * r.x); }
+ImVec2 rotate(const ImVec2& v, float angle) {
+	float c = std::cos(angle), s = std::sin(angle);
+	return ImVec2(c * v.x - s * v.y, s * v.x + c * v.y);
+}
+
+struct ClipPoint {
+	ImVec2 point;
+	int id;
+};
+
+// Keeps part of segment where dot(normal, p) <= offset, new end gets id
+int clip(const ClipPoint in[2], ClipPoint out[2], const ImVec2& normal,
+		 float offset, int id) {
+	int count = 0;
+	float d0 = dot(normal, in[0].point) - offset,
+		  d1 = dot(normal, in[1].point) - offset;
+	if (d0 <= 0) out[count++] = in[0];
+	if (d1 <= 0) out[count++] = in[1];
+	if (d0 * d1 < 0) {
+		float t = d0 / (d0 - d1);
+		out[count++] = {add(in[0].point, mul(sub(in[1].point, in[0].point), t)),
+						id};
+	}
+	return count;
+}
+
+// Largest separation of b from faces of a, with face giving it
+float maxSeparation(const Body& a, const Body& b, int& edge) {
+	float best = -INFINITY;
+	for (size_t i = 0; i < a.vertices.size(); i++) {
+		ImVec2 n = a.worldNormal(i), v = a.worldVertex(i);
+		float deepest = INFINITY;
+		for (size_t j = 0; j < b.vertices.size(); j++)
+			deepest = std::min(deepest, dot(n, sub(b.worldVertex(j), v)));
+		if (deepest > best) {
+			best = deepest;
+			edge = i;
+		}
+	}
+	return best;
+}
+}  // namespace
+
+ImVec2 Body::worldVertex(int i) const {
+	return add(position, rotate(vertices[i], angle));
+}
+
+ImVec2 Body::worldNormal(int i) const { return rotate(normals[i], angle); }
+
+Box Body::bounds() const {
+	if (shape == circle)
+		return {ImVec2(position.x - radius, position.y - radius),
+				ImVec2(position.x + radius, position.y + radius)};
+	Box b = {ImVec2(INFINITY, INFINITY), ImVec2(-INFINITY, -INFINITY)};
+	for (size_t i = 0; i < vertices.size(); i++) {
+		ImVec2 v = worldVertex(i);
+		b.min = ImVec2(std::min(b.min.x, v.x), std::min(b.min.y, v.y));
+		b.max = ImVec2(std::max(b.max.x, v.x), std::max(b.max.y, v.y));
+	}
+	return b;
+}
+
+int World::insert(Body& body, float density, float area, float inertia) {
+	if (density > 0) {
+		body.inverseMass = 1 / (density * area);
+		body.inverseInertia = 1 / (density * inertia);
+	}
+	items.push_back(body);
+	items.back().leaf = tree.insert(body.bounds(), items.size() - 1);
+	return items.size() - 1;
+}
+
+int World::addCircle(const ImVec2& position, float radius, float density) {
+	Body b;
+	b.shape = Body::Shape::circle;
+	b.radius = radius;
+	b.position = position;
+	float area = M_PI * radius * radius;
+	return insert(b, density, area, area * radius * radius / 2);
+}
+
+int World::addBox(const ImVec2& position, const ImVec2& halfSize, float angle,
+				  float density) {
+	int i = addPolygon(position,
+					   {ImVec2(-halfSize.x, -halfSize.y),
+						ImVec2(halfSize.x, -halfSize.y),
+						ImVec2(halfSize.x, halfSize.y),
+						ImVec2(-halfSize.x, halfSize.y)},
+					   density);
+	items[i].angle = angle;
+	tree.move(items[i].leaf, items[i].bounds());
+	return i;
+}
+
+// Mass and inertia from fan of triangles, vertices are moved so center of
+// mass lies at position
+int World::addPolygon(const ImVec2& position, std::vector<ImVec2> vertices,
+					  float density) {
+	Body b;
+	b.shape = Body::Shape::polygon;
+	float area = 0;
+	ImVec2 center(0, 0);
+	size_t n = vertices.size();
+	for (size_t i = 0; i < n; i++) {
+		const ImVec2 &p = vertices[i], &q = vertices[(i + 1) % n];
+		float d = cross(p, q) / 2;
+		area += d;
+		center = add(center, mul(add(p, q), d / 3));
+	}
+	center = mul(center, 1 / area);
+	float inertia = 0;
+	for (auto& v : vertices) v = sub(v, center);
+	for (size_t i = 0; i < n; i++) {
+		const ImVec2 &p = vertices[i], &q = vertices[(i + 1) % n];
+		inertia += cross(p, q) / 12 * (dot(p, p) + dot(p, q) + dot(q, q));
+		ImVec2 edge = sub(q, p);
+		float length = std::sqrt(dot(edge, edge));
+		b.normals.push_back(ImVec2(edge.y / length, -edge.x / length));
+	}
+	b.vertices = vertices;
+	b.position = add(position, center);
+	return insert(b, density, area, inertia);
+}
+
+void World::clear() {
+	for (auto& b : items) tree.remove(b.leaf);
+	items.clear();
+	manifolds.clear();
+	active.clear();
+}
+
+size_t World::contacts() const {
+	size_t count = 0;
+	for (auto* m : active) count += m->count;
+	return count;
+}
+
+void World::step(float dt) {
+	if (dt <= 0) return;
+	for (auto& b : items) {
+		if (b.isStatic()) continue;
+		b.velocity = add(b.velocity, mul(gravity, dt));
+	}
+	findPairs();
+	for (auto* m : active) prepare(*m, dt);
+	for (int i = 0; i < iterations; i++)
+		for (auto* m : active) solve(*m);
+	for (auto& b : items) {
+		if (b.isStatic()) continue;
+		b.position = add(b.position, mul(b.velocity, dt));
+		b.angle += b.angularVelocity * dt;
+	}
+}
+
+// Moving bodies look for neighbours in grown boxes, pair of moving bodies
+// is taken only from lower index
+void World::findPairs() {
+	for (auto& b : items)
+		if (!b.isStatic()) tree.move(b.leaf, b.bounds());
+	for (auto& m : manifolds) m.second.touched = false;
+	for (size_t i = 0; i < items.size(); i++) {
+		if (items[i].isStatic()) continue;
+		tree.query(tree.box(items[i].leaf), [&](int j) {
+			if (j == (int)i || (!items[j].isStatic() && j < (int)i)) return;
+			int a = std::min((int)i, j), b = std::max((int)i, j);
+			auto found = manifolds.find((uint64_t)a << 32 | b);
+			if (found == manifolds.end()) {
+				Manifold m;
+				m.a = a;
+				m.b = b;
+				found = manifolds.emplace((uint64_t)a << 32 | b, m).first;
+			}
+			found->second.touched = true;
+		});
+	}
+	active.clear();
+	for (auto it = manifolds.begin(); it != manifolds.end();) {
+		if (!it->second.touched) {
+			it = manifolds.erase(it);
+			continue;
+		}
+		collide(it->second);
+		if (it->second.count > 0) active.push_back(&it->second);
+		++it;
+	}
+}
+
+void World::collide(Manifold& m) const {
+	const Body &a = items[m.a], &b = items[m.b];
+	Contact found[2];
+	int count = 0;
+	ImVec2 normal(0, 1);
+	if (a.shape == Body::Shape::circle && b.shape == Body::Shape::circle) {
+		ImVec2 d = sub(b.position, a.position);
+		float distance = std::sqrt(dot(d, d)),
+			  separation = distance - a.radius - b.radius;
+		if (separation <= slop) {
+			if (distance > 0) normal = mul(d, 1 / distance);
+			found[count++].point = add(
+				a.position, mul(normal, a.radius + separation / 2));
+			found[0].separation = separation;
+			found[0].feature = 0;
+		}
+	} else if (a.shape != b.shape) {
+		// Circle against faces or corners of polygon, normal from polygon
+		const Body &p = a.shape == Body::Shape::polygon ? a : b,
+				   &c = a.shape == Body::Shape::polygon ? b : a;
+		ImVec2 local = rotate(sub(c.position, p.position), -p.angle);
+		size_t n = p.vertices.size();
+		int edge = 0;
+		float s = -INFINITY;
+		for (size_t i = 0; i < n; i++) {
+			float d = dot(p.normals[i], sub(local, p.vertices[i]));
+			if (d > s) {
+				s = d;
+				edge = i;
+			}
+		}
+		const ImVec2 &v1 = p.vertices[edge], &v2 = p.vertices[(edge + 1) % n];
+		ImVec2 localNormal = p.normals[edge];
+		int feature = edge;
+		float distance = s;
+		// Outside of face center lies nearest to one of its corners
+		if (s > 0) {
+			const ImVec2* corner = NULL;
+			if (dot(sub(local, v1), sub(v2, v1)) <= 0)
+				corner = &v1;
+			else if (dot(sub(local, v2), sub(v1, v2)) <= 0)
+				corner = &v2;
+			if (corner != NULL) {
+				ImVec2 d = sub(local, *corner);
+				distance = std::sqrt(dot(d, d));
+				if (distance > 0) localNormal = mul(d, 1 / distance);
+				feature = 64 + (corner - p.vertices.data());
+			}
+		}
+		float separation = distance - c.radius;
+		if (separation <= slop) {
+			normal = rotate(localNormal, p.angle);
+			found[count].point =
+				sub(c.position, mul(normal, c.radius + separation / 2));
+			found[count].separation = separation;
+			found[count++].feature = feature;
+			if (&p == &b) normal = mul(normal, -1);
+		}
+	} else {
+		// Face of reference polygon against nearest face of incident one
+		int edgeA = 0, edgeB = 0;
+		float separationA = maxSeparation(a, b, edgeA),
+			  separationB = maxSeparation(b, a, edgeB);
+		if (separationA <= slop && separationB <= slop) {
+			bool flip = separationB > 0.98f * separationA + 0.001f;
+			const Body &r = flip ? b : a, &in = flip ? a : b;
+			int edge = flip ? edgeB : edgeA;
+			ImVec2 n = r.worldNormal(edge);
+			int incident = 0;
+			float least = INFINITY;
+			for (size_t i = 0; i < in.vertices.size(); i++) {
+				float d = dot(n, in.worldNormal(i));
+				if (d < least) {
+					least = d;
+					incident = i;
+				}
+			}
+			int next = (incident + 1) % in.vertices.size();
+			ClipPoint points[2] = {{in.worldVertex(incident), incident},
+								   {in.worldVertex(next), next}},
+					  once[2], twice[2];
+			ImVec2 v1 = r.worldVertex(edge),
+				   v2 = r.worldVertex((edge + 1) % r.vertices.size()),
+				   t = sub(v2, v1);
+			t = mul(t, 1 / std::sqrt(dot(t, t)));
+			// Side planes of reference face
+			if (clip(points, once, mul(t, -1), -dot(t, v1), 32 + edge) == 2 &&
+				clip(once, twice, t, dot(t, v2), 48 + edge) == 2) {
+				for (auto& p : twice) {
+					float separation = dot(n, sub(p.point, v1));
+					if (separation > slop) continue;
+					found[count].point = sub(p.point, mul(n, separation / 2));
+					found[count].separation = separation;
+					found[count++].feature =
+						(flip ? 1 << 20 : 0) | edge << 10 | p.id;
+				}
+			}
+			normal = flip ? mul(n, -1) : n;
+		}
+	}
+
+	// Impulses of points made by same features are kept. Aligned edges
+	// switch between corner and clipped point, then nearby point is taken.
+	for (int i = 0; i < count && warmStarting; i++) {
+		int match = -1;
+		float nearest = matchDistance * matchDistance;
+		for (int j = 0; j < m.count; j++) {
+			ImVec2 d = sub(m.points[j].point, found[i].point);
+			if (m.points[j].feature == found[i].feature) {
+				match = j;
+				break;
+			}
+			if (dot(d, d) < nearest) {
+				nearest = dot(d, d);
+				match = j;
+			}
+		}
+		if (match < 0) continue;
+		found[i].normalImpulse = m.points[match].normalImpulse;
+		found[i].tangentImpulse = m.points[match].tangentImpulse;
+	}
+	m.normal = normal;
+	m.count = count;
+	for (int i = 0; i < count; i++) m.points[i] = found[i];
+	m.friction = std::sqrt(a.friction * b.friction);
+	m.restitution = std::max(a.restitution, b.restitution);
+}
+
+void World::prepare(Manifold& m, float dt) {
+	Body &a = items[m.a], &b = items[m.b];
+	ImVec2 n = m.normal, t(n.y, -n.x);
+	float mass = a.inverseMass + b.inverseMass;
+	for (int i = 0; i < m.count; i++) {
+		Contact& c = m.points[i];
+		c.ra = sub(c.point, a.position);
+		c.rb = sub(c.point, b.position);
+		float rnA = cross(c.ra, n), rnB = cross(c.rb, n),
+			  rtA = cross(c.ra, t), rtB = cross(c.rb, t);
+		c.normalMass = 1 / (mass + a.inverseInertia * rnA * rnA +
+							b.inverseInertia * rnB * rnB);
+		c.tangentMass = 1 / (mass + a.inverseInertia * rtA * rtA +
+							 b.inverseInertia * rtB * rtB);
+		// Overlap is pushed out over few steps, points not touching yet let
+		// bodies close their gap in this step, fast impacts bounce
+		c.bias = c.separation > 0
+					 ? -c.separation / dt
+					 : baumgarte / dt * std::max(-c.separation - slop, 0.0f);
+		ImVec2 dv = sub(add(b.velocity, cross(b.angularVelocity, c.rb)),
+						add(a.velocity, cross(a.angularVelocity, c.ra)));
+		float vn = dot(dv, n);
+		if (vn < -bounceSpeed)
+			c.bias = std::max(c.bias, -m.restitution * vn);
+
+		if (!warmStarting) c.normalImpulse = c.tangentImpulse = 0;
+		ImVec2 p = add(mul(n, c.normalImpulse), mul(t, c.tangentImpulse));
+		a.velocity = sub(a.velocity, mul(p, a.inverseMass));
+		a.angularVelocity -= a.inverseInertia * cross(c.ra, p);
+		b.velocity = add(b.velocity, mul(p, b.inverseMass));
+		b.angularVelocity += b.inverseInertia * cross(c.rb, p);
+	}
+
+	m.block = false;
+	if (m.count < 2) return;
+	const Contact &c1 = m.points[0], &c2 = m.points[1];
+	float rn1A = cross(c1.ra, n), rn1B = cross(c1.rb, n),
+		  rn2A = cross(c2.ra, n), rn2B = cross(c2.rb, n);
+	float k11 = 1 / c1.normalMass, k22 = 1 / c2.normalMass,
+		  k12 = mass + a.inverseInertia * rn1A * rn2A +
+				b.inverseInertia * rn1B * rn2B,
+		  determinant = k11 * k22 - k12 * k12;
+	// Ill conditioned for points lying almost on one place
+	if (k11 * k11 >= 1000 * determinant) return;
+	m.block = true;
+	m.k[0][0] = k11;
+	m.k[0][1] = m.k[1][0] = k12;
+	m.k[1][1] = k22;
+	m.inverse[0][0] = k22 / determinant;
+	m.inverse[0][1] = m.inverse[1][0] = -k12 / determinant;
+	m.inverse[1][1] = k11 / determinant;
+}
+
+// Accumulated impulses are clamped, not each change of them, so later
+// iterations can take back too strong push. Friction goes first, as normal
+// impulses matter more.
+void World::solve(Manifold& m) {
+	Body &a = items[m.a], &b = items[m.b];
+	ImVec2 n = m.normal, t(n.y, -n.x);
+	auto velocity = [&](const Contact& c) {
+		return sub(add(b.velocity, cross(b.angularVelocity, c.rb)),
+				   add(a.velocity, cross(a.angularVelocity, c.ra)));
+	};
+	auto apply = [&](const Contact& c, const ImVec2& p) {
+		a.velocity = sub(a.velocity, mul(p, a.inverseMass));
+		a.angularVelocity -= a.inverseInertia * cross(c.ra, p);
+		b.velocity = add(b.velocity, mul(p, b.inverseMass));
+		b.angularVelocity += b.inverseInertia * cross(c.rb, p);
+	};
+	for (int i = 0; i < m.count; i++) {
+		Contact& c = m.points[i];
+		float limit = m.friction * c.normalImpulse, last = c.tangentImpulse;
+		c.tangentImpulse = std::min(
+			std::max(last - c.tangentMass * dot(velocity(c), t), -limit),
+			limit);
+		apply(c, mul(t, c.tangentImpulse - last));
+	}
+
+	if (!m.block) {
+		for (int i = 0; i < m.count; i++) {
+			Contact& c = m.points[i];
+			float last = c.normalImpulse;
+			c.normalImpulse = std::max(
+				last + c.normalMass * (c.bias - dot(velocity(c), n)), 0.0f);
+			apply(c, mul(n, c.normalImpulse - last));
+		}
+		return;
+	}
+
+	// Both normal impulses at once, as linear complementarity problem
+	// solved by trying which of them are zero (block solver)
+	Contact &c1 = m.points[0], &c2 = m.points[1];
+	float old1 = c1.normalImpulse, old2 = c2.normalImpulse;
+	float b1 = dot(velocity(c1), n) - c1.bias -
+			   (m.k[0][0] * old1 + m.k[0][1] * old2),
+		  b2 = dot(velocity(c2), n) - c2.bias -
+			   (m.k[1][0] * old1 + m.k[1][1] * old2);
+	float x1 = -(m.inverse[0][0] * b1 + m.inverse[0][1] * b2),
+		  x2 = -(m.inverse[1][0] * b1 + m.inverse[1][1] * b2);
+	if (x1 < 0 || x2 < 0) {
+		// Only first point pushes
+		x1 = -c1.normalMass * b1;
+		x2 = 0;
+		if (x1 < 0 || m.k[1][0] * x1 + b2 < 0) {
+			// Only second one
+			x1 = 0;
+			x2 = -c2.normalMass * b2;
+			if (x2 < 0 || m.k[0][1] * x2 + b1 < 0) {
+				// Neither, unless points would still approach
+				x1 = x2 = 0;
+				if (b1 < 0 || b2 < 0) return;
+			}
+		}
+	}
+	c1.normalImpulse = x1;
+	c2.normalImpulse = x2;
+	apply(c1, mul(n, x1 - old1));
+	apply(c2, mul(n, x2 - old2));
+}
@@ -0,0 +1,96 @@
+#ifndef DYNAMIC_LAW_BODIES_H
+#define DYNAMIC_LAW_BODIES_H
+
+#include <imgui.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "dynamic_law_tree.hpp"
+
+namespace Dynamic {
+// Circle or convex polygon, in m with y going up. Static body has zero
+// inverse mass and never moves.
+struct Body {
+	enum Shape { circle, polygon };
+	Shape shape = circle;
+	float radius = 0.5f;		   // Of circle
+	std::vector<ImVec2> vertices;  // Counterclockwise around center of mass
+	std::vector<ImVec2> normals;   // Outward, normals[i] of edge from i
+	ImVec2 position = {0, 0};
+	ImVec2 velocity = {0, 0};
+	float angle = 0.0f, angularVelocity = 0.0f;
+	float inverseMass = 0.0f, inverseInertia = 0.0f;
+	float friction = 0.5f, restitution = 0.0f;
+	int leaf = -1;	// In tree of boxes
+
+	bool isStatic() const { return inverseMass == 0; }
+	// Vertex or normal turned and moved with body
+	ImVec2 worldVertex(int i) const;
+	ImVec2 worldNormal(int i) const;
+	Box bounds() const;
+};
+
+// Bodies pushed apart by impulses at points of contact. Pairs come from
+// tree of boxes, separating axis test gives up to two points per pair and
+// solver goes over all points several times each step (sequential
+// impulses). Impulses of points found again next step are applied at once
+// (warm starting), so stacks come to rest in few iterations.
+class World {
+   public:
+	ImVec2 gravity = {0.0f, -9.8f};	 // In m/s²
+	int iterations = 10;			 // Of solver per step
+	bool warmStarting = true;
+
+	// Density in kg/m², zero for static body. Return index of body.
+	int addCircle(const ImVec2& position, float radius, float density);
+	int addBox(const ImVec2& position, const ImVec2& halfSize, float angle,
+			   float density);
+	// Convex counterclockwise vertices around position
+	int addPolygon(const ImVec2& position, std::vector<ImVec2> vertices,
+				   float density);
+	void clear();
+	void step(float dt);
+	const std::vector<Body>& bodies() const { return items; }
+	Body& body(int i) { return items[i]; }
+	size_t contacts() const;
+	int treeHeight() const { return tree.height(); }
+
+   private:
+	struct Contact {
+		ImVec2 point;
+		float separation;	// Negative when bodies overlap
+		int feature;		// Edges or vertices which made point
+		float normalImpulse = 0.0f, tangentImpulse = 0.0f;
+		// Filled before solving
+		ImVec2 ra, rb;
+		float normalMass, tangentMass, bias;
+	};
+	// Points of contact of pair, normal goes from a to b
+	struct Manifold {
+		int a, b;
+		ImVec2 normal;
+		int count = 0;
+		Contact points[2];
+		float friction, restitution;
+		bool touched;  // Found in this step
+		// Matrix of both normal impulses and its inverse, block is false
+		// when points are too close for its inverse
+		float k[2][2], inverse[2][2];
+		bool block;
+	};
+	std::vector<Body> items;
+	BoxTree tree;
+	std::unordered_map<uint64_t, Manifold> manifolds;
+	std::vector<Manifold*> active;
+
+	int insert(Body& body, float density, float area, float inertia);
+	void findPairs();
+	void collide(Manifold& m) const;
+	void prepare(Manifold& m, float dt);
+	void solve(Manifold& m);
+};
+}  // namespace Dynamic
+
+#endif
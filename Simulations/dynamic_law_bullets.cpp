@@ -0,0 +1,167 @@
+#include "dynamic_law_bullets.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+using namespace Dynamic;
+
+Bullets::Bullets()
+	: x(capacity), y(capacity), moveX(capacity), moveY(capacity),
+	  mass(capacity) {}
+
+bool Bullets::add(const ImVec2& position, const ImVec2& move, float m) {
+	if (count == capacity) return false;
+	x[count] = position.x;
+	y[count] = position.y;
+	moveX[count] = move.x;
+	moveY[count] = move.y;
+	mass[count] = m;
+	count++;
+	return true;
+}
+
+void Bullets::remove(size_t i) {
+	count--;
+	x[i] = x[count];
+	y[i] = y[count];
+	moveX[i] = moveX[count];
+	moveY[i] = moveY[count];
+	mass[i] = mass[count];
+}
+
+void Bullets::update(float delta, float gravity) {
+	float *px = x.data(), *py = y.data(), *mx = moveX.data(),
+		  *my = moveY.data();
+	for (size_t i = 0; i < count; i++) {
+		my[i] -= gravity * delta;
+		px[i] += mx[i] * delta;
+		py[i] -= my[i] * delta;
+	}
+}
+
+void Bullets::removeOutside(const ImVec2& size) {
+	// Bullet moved into freed place is checked too
+	for (size_t i = 0; i < count;) {
+		if (x[i] < 0 || x[i] > size.x || y[i] < 0 || y[i] > size.y)
+			remove(i);
+		else
+			i++;
+	}
+}
+
+void Bullets::collide(float radius, float restitution, Obstacle& body,
+					  const ImVec2& size) {
+	if (count == 0) return;
+	// Grid has at most few cells per bullet, so tiny bullets in big window
+	// don't make it huge
+	float cell = 2 * radius, cells = 4.0f * count + 1024;
+	if (size.x * size.y > cells * cell * cell)
+		cell = std::sqrt(size.x * size.y / cells);
+	int columns = std::max((int)(size.x / cell) + 1, 1),
+		rows = std::max((int)(size.y / cell) + 1, 1);
+	auto cellX = [&](float v) {
+		return std::min(std::max((int)(v / cell), 0), columns - 1);
+	};
+	auto cellY = [&](float v) {
+		return std::min(std::max((int)(v / cell), 0), rows - 1);
+	};
+
+	// Counting sort by cell
+	start.assign(columns * rows + 1, 0);
+	cellOf.resize(count);
+	order.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		cellOf[i] = cellY(y[i]) * columns + cellX(x[i]);
+		start[cellOf[i] + 1]++;
+	}
+	for (int c = 0; c < columns * rows; c++) start[c + 1] += start[c];
+	for (size_t i = 0; i < count; i++) order[start[cellOf[i]]++] = i;
+	for (int c = columns * rows; c > 0; c--) start[c] = start[c - 1];
+	start[0] = 0;
+
+	// Every pair once, from own cell and four neighbours ahead
+	const int neighbours[4][2] = {{1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+	for (int cy = 0; cy < rows; cy++) {
+		for (int cx = 0; cx < columns; cx++) {
+			int c = cy * columns + cx;
+			for (int a = start[c]; a < start[c + 1]; a++) {
+				for (int b = a + 1; b < start[c + 1]; b++)
+					bounce(order[a], order[b], radius, restitution);
+				for (auto& n : neighbours) {
+					int nx = cx + n[0], ny = cy + n[1];
+					if (nx < 0 || nx >= columns || ny >= rows) continue;
+					int d = ny * columns + nx;
+					for (int b = start[d]; b < start[d + 1]; b++)
+						bounce(order[a], order[b], radius, restitution);
+				}
+			}
+		}
+	}
+
+	// Obstacle against bullets in cells it covers
+	float reach = body.radius + radius;
+	for (int cy = cellY(body.position.y - reach);
+		 cy <= cellY(body.position.y + reach); cy++) {
+		for (int cx = cellX(body.position.x - reach);
+			 cx <= cellX(body.position.x + reach); cx++) {
+			int c = cy * columns + cx;
+			for (int a = start[c]; a < start[c + 1]; a++) {
+				int i = order[a];
+				float dx = x[i] - body.position.x, dy = y[i] - body.position.y,
+					  distance = std::sqrt(dx * dx + dy * dy);
+				if (distance >= reach || distance == 0) continue;
+				float nx = dx / distance, ny = dy / distance;
+				float inverseSum = 1 / mass[i] + 1 / body.mass;
+				// Overlap is split by inverse of masses
+				float push = (reach - distance) / inverseSum;
+				x[i] += nx * push / mass[i];
+				y[i] += ny * push / mass[i];
+				body.position.x -= nx * push / body.mass;
+				body.position.y -= ny * push / body.mass;
+				// Velocity along normal, move has y going up
+				float v = (moveX[i] - body.move.x) * nx -
+						  (moveY[i] - body.move.y) * ny;
+				if (v >= 0) continue;
+				float impulse = -(1 + restitution) * v / inverseSum;
+				moveX[i] += impulse * nx / mass[i];
+				moveY[i] -= impulse * ny / mass[i];
+				body.move.x -= impulse * nx / body.mass;
+				body.move.y += impulse * ny / body.mass;
+			}
+		}
+	}
+}
+
+// Overlapping bullets are pushed apart and, when they approach, get
+// impulse along line of centers
+void Bullets::bounce(int i, int j, float radius, float restitution) {
+	float dx = x[j] - x[i], dy = y[j] - y[i], d2 = dx * dx + dy * dy;
+	if (d2 >= 4 * radius * radius || d2 == 0) return;
+	float distance = std::sqrt(d2), nx = dx / distance, ny = dy / distance;
+	float inverseSum = 1 / mass[i] + 1 / mass[j];
+	float push = (2 * radius - distance) / inverseSum;
+	x[i] -= nx * push / mass[i];
+	y[i] -= ny * push / mass[i];
+	x[j] += nx * push / mass[j];
+	y[j] += ny * push / mass[j];
+	// Velocity of j relative to i along normal, move has y going up
+	float v = (moveX[j] - moveX[i]) * nx - (moveY[j] - moveY[i]) * ny;
+	if (v >= 0) return;
+	float impulse = -(1 + restitution) * v / inverseSum;
+	moveX[i] -= impulse * nx / mass[i];
+	moveY[i] += impulse * ny / mass[i];
+	moveX[j] += impulse * nx / mass[j];
+	moveY[j] -= impulse * ny / mass[j];
+}
+
+void Bullets::draw(ImDrawList* drawList, const ImVec2& origin, float scale,
+				   float radius) const {
+	for (size_t i = 0; i < count; i++)
+		drawList->AddCircleFilled(
+			ImVec2(origin.x + x[i] * scale, origin.y + y[i] * scale),
+			radius * scale, ImColor(70, 70, 70));
+}
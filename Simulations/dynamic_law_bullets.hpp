@@ -0,0 +1,54 @@
+#ifndef DYNAMIC_LAW_BULLETS_H
+#define DYNAMIC_LAW_BULLETS_H
+
+#include <imgui.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace Dynamic {
+// Circle bullets bounce off, same units as bullets
+struct Obstacle {
+	ImVec2 position;
+	ImVec2 move;
+	float mass;
+	float radius;
+};
+
+// Bullets of cannon kept as separate arrays of coordinates in preallocated
+// pool, so update loop has no branches and compiler turns it into vector
+// instructions. Removed bullet takes place of last one.
+class Bullets {
+   public:
+	static const size_t capacity = 100000;
+	Bullets();
+
+	size_t size() const { return count; }
+	// Position in m with y going down, move in m/s with y going up as for
+	// cannon. False when pool is full.
+	bool add(const ImVec2& position, const ImVec2& move, float mass);
+	void remove(size_t i);
+	void clear() { count = 0; }
+	void update(float delta, float gravity);
+	// Removes bullets which left box from 0 to size, in m
+	void removeOutside(const ImVec2& size);
+	// Bounces bullets of radius off each other and off body, which takes
+	// momentum of impacts. Pairs are found on uniform grid with cells of
+	// bullet diameter over box from 0 to size.
+	void collide(float radius, float restitution, Obstacle& body,
+				 const ImVec2& size);
+	void draw(ImDrawList* drawList, const ImVec2& origin, float scale,
+			  float radius) const;
+
+   private:
+	size_t count = 0;
+	std::vector<float> x, y, moveX, moveY, mass;
+	// Bullets sorted by cell of grid, cell c holds order[start[c] ..
+	// start[c + 1])
+	std::vector<int> cellOf, start, order;
+
+	void bounce(int i, int j, float radius, float restitution);
+};
+}  // namespace Dynamic
+
+#endif
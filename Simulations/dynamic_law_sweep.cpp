@@ -0,0 +1,137 @@
+#include "dynamic_law_sweep.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "../parallel.hpp"
+
+using namespace Dynamic;
+
+const Sweep::Range& Sweep::xRange() const {
+	return experiment == cannonRange ? angle : inclination;
+}
+
+const Sweep::Range& Sweep::yRange() const {
+	return experiment == cannonRange ? speed : friction;
+}
+
+// Values which don't affect experiment are left out, so they don't throw
+// away its result
+Sweep::Settings Sweep::current() const {
+	Settings s = {resolution, xRange(), yRange(), gravity, 0.0f, 0.0f};
+	if (experiment == cannonRange)
+		s.drag = drag;
+	else
+		s.distance = distance;
+	return s;
+}
+
+void Sweep::update() {
+	Result& r = results[experiment];
+	Settings s = current();
+	if (r.valid && r.settings == s) return;
+	r.valid = true;
+	r.settings = s;
+	r.values.resize(resolution * resolution);
+	parallelFor(resolution, [&](size_t begin, size_t end) {
+		for (size_t row = begin; row < end; row++) {
+			float y = s.y.max - (row + 0.5f) / resolution * (s.y.max - s.y.min);
+			for (int column = 0; column < resolution; column++) {
+				float x = s.x.min +
+						  (column + 0.5f) / resolution * (s.x.max - s.x.min);
+				r.values[row * resolution + column] =
+					experiment == cannonRange ? cannon(x, y) : slope(x, y);
+			}
+		}
+	});
+	r.max = 0.0f;
+	for (float v : r.values)
+		if (std::isfinite(v)) r.max = std::max(r.max, v);
+	color(r);
+}
+
+void Sweep::draw(ImDrawList* drawList, const ImVec2& origin,
+				 const ImVec2& size) const {
+	const Result& r = results[experiment];
+	if (r.texture.empty()) return;
+	drawList->AddImage(r.texture.id(), origin,
+					   ImVec2(origin.x + size.x, origin.y + size.y));
+}
+
+float Sweep::valueAt(float x, float y) const {
+	const Result& r = results[experiment];
+	if (!r.valid) return NAN;
+	int n = r.settings.resolution,
+		column = std::min(std::max((int)(x * n), 0), n - 1),
+		row = std::min(std::max((int)((1 - y) * n), 0), n - 1);
+	return r.values[row * n + column];
+}
+
+// Bullet leaves barrel at ground level and flies until it comes back to it
+float Sweep::cannon(float angle, float speed) const {
+	double a = angle * M_PI / 180, vx = speed * std::cos(a),
+		   vy = speed * std::sin(a), x = 0, y = 0;
+	// Without air flight takes at most 2 v / g, drag only shortens it
+	double dt = 2 * speed / gravity / steps;
+	for (int i = 0; i < 2 * steps; i++) {
+		double v = std::sqrt(vx * vx + vy * vy), lastX = x, lastY = y,
+			   lastVx = vx, lastVy = vy;
+		vx -= drag * v * vx * dt;
+		vy -= (gravity + drag * v * vy) * dt;
+		// Mean of velocities, exact without air
+		x += (lastVx + vx) / 2 * dt;
+		y += (lastVy + vy) / 2 * dt;
+		if (y < 0) return lastX + (x - lastX) * lastY / (lastY - y);
+	}
+	return x;
+}
+
+// Body starts at rest on top of plane, as in inclined plane window
+float Sweep::slope(float inclination, float friction) const {
+	double a = inclination * M_PI / 180,
+		   acceleration = gravity * (std::sin(a) - friction * std::cos(a));
+	if (acceleration <= 0) return NAN;
+	double dt = std::sqrt(2 * distance / acceleration) / steps, position = 0,
+		   speed = 0;
+	for (int i = 0; i < 2 * steps; i++) {
+		double last = position;
+		position += (speed + acceleration * dt / 2) * dt;
+		speed += acceleration * dt;
+		if (position >= distance)
+			return (i + (distance - last) / (position - last)) * dt;
+	}
+	return NAN;
+}
+
+// Viridis, body staying on plane is dark gray
+void Sweep::color(Result& r) {
+	static const uint8_t stops[5][3] = {{68, 1, 84},
+										{59, 82, 139},
+										{33, 145, 140},
+										{94, 201, 98},
+										{253, 231, 37}};
+	r.pixels.resize(r.values.size());
+	for (size_t i = 0; i < r.values.size(); i++) {
+		float v = r.values[i];
+		if (!std::isfinite(v)) {
+			r.pixels[i] = 0xFF303030;
+			continue;
+		}
+		float pos = r.max > 0 ? v / r.max * 4 : 0;
+		int s = std::min(std::max((int)pos, 0), 3);
+		float t = std::min(pos - s, 1.0f);
+		uint32_t rgb = 0xFF000000;
+		for (int c = 0; c < 3; c++) {
+			uint32_t channel =
+				stops[s][c] + (stops[s + 1][c] - stops[s][c]) * t + 0.5f;
+			rgb |= channel << (16 - 8 * c);
+		}
+		r.pixels[i] = rgb;
+	}
+	r.texture.upload(r.pixels.data(), r.settings.resolution,
+					 r.settings.resolution);
+}
@@ -0,0 +1,74 @@
+#ifndef DYNAMIC_LAW_SWEEP_H
+#define DYNAMIC_LAW_SWEEP_H
+
+#include <imgui.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "../texture.hpp"
+
+namespace Dynamic {
+// Runs experiment of cannon or inclined plane without drawing for every
+// cell of grid over two parameters, cells are integrated in parallel.
+// Result of each experiment stays until its settings change.
+class Sweep {
+   public:
+	enum Experiment { cannonRange, slopeTime };
+	struct Range {
+		float min, max;
+		bool operator==(const Range& r) const {
+			return min == r.min && max == r.max;
+		}
+	};
+	Experiment experiment = cannonRange;
+	int resolution = 64;			// Cells along each axis
+	Range angle = {0.0f, 90.0f};	// Of barrel, in degrees
+	Range speed = {1.0f, 40.0f};	// Of bullet, in m/s
+	Range inclination = {0.0f, 90.0f};	// Of plane, in degrees
+	Range friction = {0.0f, 1.0f};		// Ratio on plane
+	float gravity = 9.8f;				// In m/s²
+	float drag = 0.0f;		 // Of air on bullet, acceleration / v², in 1/m
+	float distance = 5.0f;	 // Length of plane, in m
+
+	void update();
+	// Parameter of experiment along x goes right, along y goes up
+	void draw(ImDrawList* drawList, const ImVec2& origin,
+			  const ImVec2& size) const;
+	const Range& xRange() const;
+	const Range& yRange() const;
+	// Range in m or time to bottom in s at place from 0 to 1 along both
+	// ranges, NaN when body stays on plane
+	float valueAt(float x, float y) const;
+	float maxValue() const { return results[experiment].max; }
+
+   private:
+	static const int steps = 1000;	// Of integration over expected time
+	struct Settings {
+		int resolution;
+		Range x, y;
+		float gravity, drag, distance;
+		bool operator==(const Settings& s) const {
+			return resolution == s.resolution && x == s.x && y == s.y &&
+				   gravity == s.gravity && drag == s.drag &&
+				   distance == s.distance;
+		}
+	};
+	struct Result {
+		bool valid = false;
+		Settings settings;
+		std::vector<float> values;	// Rows from largest y
+		float max = 0.0f;
+		std::vector<uint32_t> pixels;
+		Texture texture;
+	};
+	Result results[2];	// Per experiment
+
+	Settings current() const;
+	float cannon(float angle, float speed) const;
+	float slope(float inclination, float friction) const;
+	void color(Result& r);
+};
+}  // namespace Dynamic
+
+#endif
@@ -0,0 +1,162 @@
+#include "dynamic_law_tree.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using namespace Dynamic;
+
+namespace {
+Box merge(const Box& a, const Box& b) {
+	return {ImVec2(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y)),
+			ImVec2(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y))};
+}
+
+// Cost of box for choosing place of new leaf
+float perimeter(const Box& b) {
+	return 2 * (b.max.x - b.min.x + b.max.y - b.min.y);
+}
+}  // namespace
+
+int BoxTree::allocate() {
+	if (freeNodes.empty()) {
+		nodes.push_back(Node());
+		return nodes.size() - 1;
+	}
+	int n = freeNodes.back();
+	freeNodes.pop_back();
+	nodes[n] = Node();
+	return n;
+}
+
+int BoxTree::insert(const Box& box, int value) {
+	int leaf = allocate();
+	nodes[leaf].box = {ImVec2(box.min.x - margin, box.min.y - margin),
+					   ImVec2(box.max.x + margin, box.max.y + margin)};
+	nodes[leaf].value = value;
+	insertLeaf(leaf);
+	return leaf;
+}
+
+void BoxTree::remove(int leaf) {
+	removeLeaf(leaf);
+	nodes[leaf].height = -1;
+	freeNodes.push_back(leaf);
+}
+
+bool BoxTree::move(int leaf, const Box& box) {
+	if (nodes[leaf].box.contains(box)) return false;
+	removeLeaf(leaf);
+	nodes[leaf].box = {ImVec2(box.min.x - margin, box.min.y - margin),
+					   ImVec2(box.max.x + margin, box.max.y + margin)};
+	insertLeaf(leaf);
+	return true;
+}
+
+// Goes down to sibling where growth of boxes on the way costs least
+void BoxTree::insertLeaf(int leaf) {
+	if (root < 0) {
+		root = leaf;
+		nodes[root].parent = -1;
+		return;
+	}
+	Box box = nodes[leaf].box;  // Copy, allocation moves nodes
+	int sibling = root;
+	while (!nodes[sibling].leaf()) {
+		const Node& n = nodes[sibling];
+		float area = perimeter(n.box), combined = perimeter(merge(n.box, box));
+		// Cost of new parent here and growth of this node for deeper place
+		float cost = 2 * combined, inherited = 2 * (combined - area);
+		float childCost[2];
+		for (int i = 0; i < 2; i++) {
+			const Node& c = nodes[n.children[i]];
+			float grown = perimeter(merge(c.box, box));
+			childCost[i] = (c.leaf() ? grown : grown - perimeter(c.box)) +
+						   inherited;
+		}
+		if (cost < childCost[0] && cost < childCost[1]) break;
+		sibling = n.children[childCost[0] < childCost[1] ? 0 : 1];
+	}
+
+	int oldParent = nodes[sibling].parent, parent = allocate();
+	nodes[parent].parent = oldParent;
+	nodes[parent].box = merge(box, nodes[sibling].box);
+	nodes[parent].height = nodes[sibling].height + 1;
+	nodes[parent].children[0] = sibling;
+	nodes[parent].children[1] = leaf;
+	nodes[sibling].parent = parent;
+	nodes[leaf].parent = parent;
+	if (oldParent < 0) {
+		root = parent;
+	} else {
+		Node& p = nodes[oldParent];
+		p.children[p.children[0] == sibling ? 0 : 1] = parent;
+	}
+	refit(nodes[leaf].parent);
+}
+
+void BoxTree::removeLeaf(int leaf) {
+	if (leaf == root) {
+		root = -1;
+		return;
+	}
+	int parent = nodes[leaf].parent, grandParent = nodes[parent].parent;
+	int sibling = nodes[parent].children[nodes[parent].children[0] == leaf];
+	// Sibling takes place of parent
+	nodes[sibling].parent = grandParent;
+	if (grandParent < 0) {
+		root = sibling;
+	} else {
+		Node& g = nodes[grandParent];
+		g.children[g.children[0] == parent ? 0 : 1] = sibling;
+		refit(grandParent);
+	}
+	nodes[parent].height = -1;
+	freeNodes.push_back(parent);
+}
+
+// Boxes and heights of ancestors follow change, rotating on the way up
+void BoxTree::refit(int node) {
+	while (node >= 0) {
+		node = balance(node);
+		Node& n = nodes[node];
+		const Node &a = nodes[n.children[0]], &b = nodes[n.children[1]];
+		n.height = 1 + std::max(a.height, b.height);
+		n.box = merge(a.box, b.box);
+		node = n.parent;
+	}
+}
+
+int BoxTree::balance(int a) {
+	if (nodes[a].leaf() || nodes[a].height < 2) return a;
+	int b = nodes[a].children[0], c = nodes[a].children[1];
+	int difference = nodes[c].height - nodes[b].height;
+	if (std::abs(difference) <= 1) return a;
+	// Taller child goes up, its taller child stays under it and other one
+	// goes under a
+	int up = difference > 0 ? c : b, other = difference > 0 ? b : c;
+	int f = nodes[up].children[0], g = nodes[up].children[1];
+	if (nodes[f].height < nodes[g].height) std::swap(f, g);
+
+	nodes[up].parent = nodes[a].parent;
+	nodes[a].parent = up;
+	if (nodes[up].parent < 0) {
+		root = up;
+	} else {
+		Node& p = nodes[nodes[up].parent];
+		p.children[p.children[0] == a ? 0 : 1] = up;
+	}
+	nodes[up].children[0] = a;
+	nodes[up].children[1] = f;
+	nodes[a].children[0] = other;
+	nodes[a].children[1] = g;
+	nodes[g].parent = a;
+
+	for (int n : {a, up}) {
+		Node& m = nodes[n];
+		m.box = merge(nodes[m.children[0]].box, nodes[m.children[1]].box);
+		m.height = 1 + std::max(nodes[m.children[0]].height,
+								nodes[m.children[1]].height);
+	}
+	return up;
+}
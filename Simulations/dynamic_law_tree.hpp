@@ -0,0 +1,81 @@
+#ifndef DYNAMIC_LAW_TREE_H
+#define DYNAMIC_LAW_TREE_H
+
+#include <imgui.h>
+
+#include <vector>
+
+namespace Dynamic {
+struct Box {
+	ImVec2 min, max;
+	bool overlaps(const Box& b) const {
+		return min.x <= b.max.x && b.min.x <= max.x && min.y <= b.max.y &&
+			   b.min.y <= max.y;
+	}
+	bool contains(const Box& b) const {
+		return min.x <= b.min.x && min.y <= b.min.y && b.max.x <= max.x &&
+			   b.max.y <= max.y;
+	}
+};
+
+// Bounding boxes of moving bodies in binary tree, rebalanced by rotations
+// as it changes. Leaves hold boxes grown by margin, so a body moving
+// inside its box doesn't touch the tree.
+class BoxTree {
+   public:
+	float margin = 0.1f;  // Added on every side of leaf, in m
+
+	// Returns leaf holding box, value is given back by query
+	int insert(const Box& box, int value);
+	void remove(int leaf);
+	// True when leaf had to be moved, box left grown box of leaf
+	bool move(int leaf, const Box& box);
+	const Box& box(int leaf) const { return nodes[leaf].box; }
+	// Calls found(value) for every leaf overlapping box
+	template <typename F>
+	void query(const Box& box, F found) const;
+	int height() const { return root < 0 ? 0 : nodes[root].height; }
+
+   private:
+	struct Node {
+		Box box;
+		int parent = -1;
+		int children[2] = {-1, -1};
+		int height = 0;	 // 0 for leaf, -1 for free node
+		int value = -1;
+		bool leaf() const { return children[0] < 0; }
+	};
+	std::vector<Node> nodes;
+	std::vector<int> freeNodes;
+	mutable std::vector<int> stack;
+	int root = -1;
+
+	int allocate();
+	void insertLeaf(int leaf);
+	void removeLeaf(int leaf);
+	// Rotates subtree when heights of children differ by more than one,
+	// returns new root of subtree
+	int balance(int node);
+	void refit(int node);
+};
+
+template <typename F>
+void BoxTree::query(const Box& box, F found) const {
+	if (root < 0) return;
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty()) {
+		const Node& n = nodes[stack.back()];
+		stack.pop_back();
+		if (!n.box.overlaps(box)) continue;
+		if (n.leaf()) {
+			found(n.value);
+		} else {
+			stack.push_back(n.children[0]);
+			stack.push_back(n.children[1]);
+		}
+	}
+}
+}  // namespace Dynamic
+
+#endif
@@ -22,9 +22,6 @@ class ElectricField : public View {
 
 	void drawElectroMagneticPendulum();
 	bool isElectroMagneticPendulumActive = false;
-
-	std::vector<Force> calcNeedleForces(const ImVec2 &location,
-										std::vector<object> &objects);
 };
 
 #endif
\ No newline at end of file
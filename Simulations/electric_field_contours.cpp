@@ -0,0 +1,237 @@
+#include "electric_field_contours.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "../parallel.hpp"
+
+using namespace Electric;
+
+namespace {
+uint64_t endKey(int level, uint32_t edge) {
+	return ((uint64_t)(uint32_t)level << 32) | edge;
+}
+}  // namespace
+
+void Equipotentials::update(const Scene& scene, const ImVec2& size,
+							float scale) {
+	// Levels need positive distance between them
+	if (!(step > 0)) {
+		lines.clear();
+		evaluatedStep = step;
+		return;
+	}
+	int w = std::ceil(std::max(size.x, 1.0f) / pixelStep / tileSize),
+		h = std::ceil(std::max(size.y, 1.0f) / pixelStep / tileSize);
+	std::vector<bool> resample;
+
+	if (w != tilesX || h != tilesY || scale != evaluatedScale ||
+		pixelStep != evaluatedPixelStep) {
+		tilesX = w;
+		tilesY = h;
+		nodesX = w * tileSize + 1;
+		nodesY = h * tileSize + 1;
+		evaluatedScale = scale;
+		evaluatedPixelStep = pixelStep;
+		samples.assign(nodesX * nodesY, 0.0f);
+		tiles.assign(tilesX * tilesY, Tile());
+		resample.assign(tiles.size(), true);
+	} else {
+		resample.assign(tiles.size(), false);
+		if (scene != lastScene) {
+			float cell = pixelStep / scale;
+			for (int t = 0; t < (int)tiles.size(); t++) {
+				ImVec2 min((t % tilesX) * tileSize * cell,
+						   (t / tilesX) * tileSize * cell);
+				ImVec2 max(min.x + tileSize * cell, min.y + tileSize * cell);
+				tiles[t].change += scene.changeBound(lastScene, min, max, true);
+				if (tiles[t].change > changeTolerance * step)
+					resample[t] = true;
+			}
+		}
+	}
+	lastScene = scene;
+
+	// Tile lines use nodes on right and bottom border owned by neighbours
+	std::vector<int> sampled, contoured;
+	for (int t = 0; t < (int)tiles.size(); t++) {
+		if (resample[t]) sampled.push_back(t);
+		int x = t % tilesX, y = t / tilesX;
+		bool neighbour = (x + 1 < tilesX && resample[t + 1]) ||
+						 (y + 1 < tilesY && resample[t + tilesX]) ||
+						 (x + 1 < tilesX && y + 1 < tilesY &&
+						  resample[t + tilesX + 1]);
+		if (resample[t] || neighbour || step != evaluatedStep)
+			contoured.push_back(t);
+	}
+	evaluatedStep = step;
+	if (contoured.empty()) return;
+
+	parallelFor(sampled.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) sampleTile(scene, sampled[i]);
+	});
+	parallelFor(contoured.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) contourTile(contoured[i]);
+	});
+	stitch();
+}
+
+void Equipotentials::draw(ImDrawList* drawList, const ImVec2& origin,
+						  float scale) const {
+	std::vector<ImVec2> screen;
+	for (auto& line : lines) {
+		screen.resize(line.points.size());
+		for (size_t i = 0; i < line.points.size(); i++)
+			screen[i] = ImVec2(origin.x + line.points[i].x * scale,
+							   origin.y + line.points[i].y * scale);
+		ImColor color = line.level > 0
+							? ImColor(255, 170, 170, 200)
+							: (line.level < 0 ? ImColor(170, 170, 255, 200)
+											  : ImColor(255, 255, 255, 200));
+		drawList->AddPolyline(screen.data(), screen.size(), color, 0, 1.0f);
+	}
+}
+
+// Tile owns nodes on its top and left border, last row and column own both
+void Equipotentials::sampleTile(const Scene& scene, int tile) {
+	float cell = evaluatedPixelStep / evaluatedScale;
+	int tx = tile % tilesX, ty = tile / tilesX;
+	int x0 = tx * tileSize, y0 = ty * tileSize;
+	int x1 = x0 + tileSize + (tx == tilesX - 1),
+		y1 = y0 + tileSize + (ty == tilesY - 1);
+	for (int y = y0; y < y1; y++)
+		for (int x = x0; x < x1; x++)
+			samples[y * nodesX + x] =
+				scene.potentialAt(ImVec2(x * cell, y * cell));
+	tiles[tile].change = 0.0f;
+}
+
+void Equipotentials::contourTile(int tile) {
+	float cell = evaluatedPixelStep / evaluatedScale;
+	int x0 = (tile % tilesX) * tileSize, y0 = (tile / tilesX) * tileSize;
+	std::vector<Segment>& segments = tiles[tile].segments;
+	segments.clear();
+
+	for (int y = y0; y < y0 + tileSize; y++) {
+		for (int x = x0; x < x0 + tileSize; x++) {
+			// Corners clockwise from top left, edges top, right, bottom, left
+			int n = y * nodesX + x;
+			float v[4] = {samples[n], samples[n + 1], samples[n + 1 + nodesX],
+						  samples[n + nodesX]};
+			uint32_t edges[4] = {2 * (uint32_t)n, 2 * (uint32_t)(n + 1) + 1,
+								 2 * (uint32_t)(n + nodesX),
+								 2 * (uint32_t)n + 1};
+			ImVec2 corner[4] = {
+				{x * cell, y * cell}, {(x + 1) * cell, y * cell},
+				{(x + 1) * cell, (y + 1) * cell}, {x * cell, (y + 1) * cell}};
+			float low = std::min(std::min(v[0], v[1]), std::min(v[2], v[3])),
+				  high = std::max(std::max(v[0], v[1]), std::max(v[2], v[3]));
+			// Quotient is checked before it fits in int
+			double from = std::ceil((double)low / step),
+				   to = std::floor((double)high / step);
+			if (!std::isfinite(from) || !std::isfinite(to) ||
+				to - from >= maxCrossings || std::fabs(from) > INT32_MAX - 1 ||
+				std::fabs(to) > INT32_MAX - 1)
+				continue;
+			int first = from, last = to;
+
+			for (int level = first; level <= last; level++) {
+				float value = level * step;
+				int mask = 0;
+				for (int c = 0; c < 4; c++)
+					if (v[c] > value) mask |= 1 << c;
+				if (mask == 0 || mask == 15) continue;
+
+				auto crossing = [&](int e) {
+					int a = e, b = (e + 1) % 4;
+					float t = (value - v[a]) / (v[b] - v[a]);
+					return ImVec2(
+						corner[a].x + (corner[b].x - corner[a].x) * t,
+						corner[a].y + (corner[b].y - corner[a].y) * t);
+				};
+				auto add = [&](int e1, int e2) {
+					segments.push_back(Segment{crossing(e1), crossing(e2),
+											   endKey(level, edges[e1]),
+											   endKey(level, edges[e2])});
+				};
+				// Edge e joins corners e and e + 1, so it is crossed when
+				// they lie on different sides of value
+				int crossed[4], count = 0;
+				for (int e = 0; e < 4; e++)
+					if (((mask >> e) & 1) != ((mask >> ((e + 1) % 4)) & 1))
+						crossed[count++] = e;
+				if (count == 2) {
+					add(crossed[0], crossed[1]);
+				} else {
+					// Saddle, center value decides which corners connect
+					bool centerAbove = (v[0] + v[1] + v[2] + v[3]) / 4 > value;
+					bool firstAbove = mask & 1;
+					if (centerAbove == firstAbove) {
+						add(0, 1);
+						add(2, 3);
+					} else {
+						add(3, 0);
+						add(1, 2);
+					}
+				}
+			}
+		}
+	}
+}
+
+// Joins segments sharing ends into polylines
+void Equipotentials::stitch() {
+	std::vector<const Segment*> all;
+	for (auto& t : tiles)
+		for (auto& s : t.segments) all.push_back(&s);
+
+	std::unordered_multimap<uint64_t, size_t> ends;
+	ends.reserve(all.size() * 2);
+	for (size_t i = 0; i < all.size(); i++) {
+		ends.emplace(all[i]->keyA, i);
+		ends.emplace(all[i]->keyB, i);
+	}
+	std::vector<bool> used(all.size(), false);
+	auto other = [&](uint64_t key, size_t current) -> long {
+		auto range = ends.equal_range(key);
+		for (auto it = range.first; it != range.second; ++it)
+			if (it->second != current && !used[it->second]) return it->second;
+		return -1;
+	};
+
+	lines.clear();
+	std::vector<ImVec2> back;
+	for (size_t i = 0; i < all.size(); i++) {
+		if (used[i]) continue;
+		used[i] = true;
+		Line line;
+		line.level = all[i]->keyA >> 32;
+		line.points = {all[i]->a, all[i]->b};
+
+		// Extend forward from end b, then backward from end a
+		for (int side = 0; side < 2; side++) {
+			uint64_t key = side == 0 ? all[i]->keyB : all[i]->keyA;
+			back.clear();
+			for (long next = other(key, i); next != -1;
+				 next = other(key, next)) {
+				used[next] = true;
+				const Segment& s = *all[next];
+				bool forward = s.keyA == key;
+				back.push_back(forward ? s.b : s.a);
+				key = forward ? s.keyB : s.keyA;
+			}
+			if (side == 0) {
+				line.points.insert(line.points.end(), back.begin(), back.end());
+			} else {
+				line.points.insert(line.points.begin(), back.rbegin(),
+								   back.rend());
+			}
+		}
+		lines.push_back(std::move(line));
+	}
+}
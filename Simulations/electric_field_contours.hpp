@@ -0,0 +1,54 @@
+#ifndef ELECTRIC_FIELD_CONTOURS_H
+#define ELECTRIC_FIELD_CONTOURS_H
+
+#include <imgui.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "electric_field_scene.hpp"
+
+namespace Electric {
+// Equipotential lines found with marching squares on sampled potential.
+// Grid is split to tiles, tiles are sampled again only when change of
+// scene could move their lines.
+class Equipotentials {
+   public:
+	float step = 5e6f;	 // Potential between neighbouring lines in volts
+	int pixelStep = 6;	 // Screen pixels between samples
+
+	void update(const Scene& scene, const ImVec2& size, float scale);
+	void draw(ImDrawList* drawList, const ImVec2& origin, float scale) const;
+
+   private:
+	static const int tileSize = 16;		  // Cells per side of tile
+	static const int maxCrossings = 6;	  // Denser cells are left empty
+	const float changeTolerance = 0.02f;  // Part of step
+	struct Segment {
+		ImVec2 a, b;
+		uint64_t keyA, keyB;  // Level and grid edge of ends
+	};
+	struct Tile {
+		std::vector<Segment> segments;
+		float change = 0.0f;
+	};
+	struct Line {
+		std::vector<ImVec2> points;
+		int level;
+	};
+
+	int nodesX = 0, nodesY = 0, tilesX = 0, tilesY = 0;
+	float evaluatedStep = 0, evaluatedScale = 0;
+	int evaluatedPixelStep = 0;
+	Scene lastScene;
+	std::vector<float> samples;
+	std::vector<Tile> tiles;
+	std::vector<Line> lines;
+
+	void sampleTile(const Scene& scene, int tile);
+	void contourTile(int tile);
+	void stitch();
+};
+}  // namespace Electric
+
+#endif
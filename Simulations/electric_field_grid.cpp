@@ -0,0 +1,129 @@
+#include "electric_field_grid.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <vector>
+
+#include "../parallel.hpp"
+
+using namespace Electric;
+
+void NeedleGrid::update(const Scene& scene, const ImVec2& size) {
+	Settings settings = {adaptive,			 density, angleTolerance,
+						 magnitudeTolerance, minCell, maxNeedles,
+						 size};
+	if (settings == placed && scene == lastScene) return;
+	placed = settings;
+	lastScene = scene;
+	if (adaptive)
+		placeAdaptive(scene, size);
+	else
+		placeUniform(scene, size);
+}
+
+void NeedleGrid::placeUniform(const Scene& scene, const ImVec2& size) {
+	float step = 1 / density;
+	int columns = std::ceil(size.x / step), rows = std::ceil(size.y / step);
+	result.resize(std::max(columns, 0) * std::max(rows, 0));
+	parallelFor(result.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			ImVec2 loc((i / rows) * step, (i % rows) * step);
+			result[i] = Needle{loc, scene.fieldAt(loc), step};
+		}
+	});
+}
+
+void NeedleGrid::placeAdaptive(const Scene& scene, const ImVec2& size) {
+	auto field = [&](float x, float y) { return scene.fieldAt(ImVec2(x, y)); };
+	auto makeCell = [&](const ImVec2& min, float side, const ImVec2* corners) {
+		Cell cell;
+		cell.min = min;
+		cell.size = side;
+		for (int c = 0; c < 4; c++) cell.corners[c] = corners[c];
+		cell.center = field(min.x + side / 2, min.y + side / 2);
+		cell.error = side / 2 < minCell ? 0.0f : cellError(cell);
+		return cell;
+	};
+
+	// Roots are about four per shorter window side
+	float root = std::max(std::min(size.x, size.y) / 4, minCell);
+	std::priority_queue<Cell> open;
+	for (float y = 0; y < size.y; y += root) {
+		for (float x = 0; x < size.x; x += root) {
+			ImVec2 corners[4] = {field(x, y), field(x + root, y),
+								 field(x, y + root),
+								 field(x + root, y + root)};
+			open.push(makeCell(ImVec2(x, y), root, corners));
+		}
+	}
+
+	// Split cells with largest error first, in batches evaluated in parallel
+	size_t leaves = open.size();
+	std::vector<Cell> batch, children;
+	while (!open.empty() && leaves + 3 <= (size_t)maxNeedles) {
+		batch.clear();
+		while (!open.empty() && batch.size() < 64 &&
+			   leaves + 3 * (batch.size() + 1) <= (size_t)maxNeedles &&
+			   open.top().error > 1.0f) {
+			batch.push_back(open.top());
+			open.pop();
+		}
+		if (batch.empty()) break;
+		leaves += 3 * batch.size();
+
+		children.resize(4 * batch.size());
+		parallelFor(batch.size(), [&](size_t begin, size_t end) {
+			for (size_t b = begin; b < end; b++) {
+				const Cell& p = batch[b];
+				float h = p.size / 2;
+				ImVec2 top = field(p.min.x + h, p.min.y),
+					   left = field(p.min.x, p.min.y + h),
+					   right = field(p.min.x + p.size, p.min.y + h),
+					   bottom = field(p.min.x + h, p.min.y + p.size);
+				ImVec2 c[4][4] = {
+					{p.corners[0], top, left, p.center},
+					{top, p.corners[1], p.center, right},
+					{left, p.center, p.corners[2], bottom},
+					{p.center, right, bottom, p.corners[3]}};
+				for (int q = 0; q < 4; q++) {
+					ImVec2 min(p.min.x + (q % 2) * h, p.min.y + (q / 2) * h);
+					children[4 * b + q] = makeCell(min, h, c[q]);
+				}
+			}
+		});
+		for (auto& c : children) open.push(c);
+	}
+
+	result.clear();
+	result.reserve(leaves);
+	auto addNeedle = [&](const Cell& c) {
+		if (c.min.x >= size.x || c.min.y >= size.y) return;
+		result.push_back(Needle{
+			ImVec2(c.min.x + c.size / 2, c.min.y + c.size / 2), c.center,
+			c.size});
+	};
+	for (; !open.empty(); open.pop()) addNeedle(open.top());
+}
+
+// Variation of field inside cell relative to tolerances, above 1 needs split
+float NeedleGrid::cellError(const Cell& cell) const {
+	float centerLength =
+		std::sqrt(cell.center.x * cell.center.x + cell.center.y * cell.center.y);
+	float minLength = centerLength, maxLength = centerLength, maxAngle = 0;
+	for (auto& c : cell.corners) {
+		float length = std::sqrt(c.x * c.x + c.y * c.y);
+		minLength = std::min(minLength, length);
+		maxLength = std::max(maxLength, length);
+		if (length > 0 && centerLength > 0) {
+			float cosine = (c.x * cell.center.x + c.y * cell.center.y) /
+						   (length * centerLength);
+			maxAngle = std::max(
+				maxAngle, std::acos(std::min(std::max(cosine, -1.0f), 1.0f)));
+		}
+	}
+	float magnitude = minLength > 0 ? std::log(maxLength / minLength) : INFINITY;
+	return std::max(maxAngle / angleTolerance, magnitude / magnitudeTolerance);
+}
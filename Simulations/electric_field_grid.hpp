@@ -0,0 +1,63 @@
+#ifndef ELECTRIC_FIELD_GRID_H
+#define ELECTRIC_FIELD_GRID_H
+
+#include <imgui.h>
+
+#include <vector>
+
+#include "electric_field_scene.hpp"
+
+namespace Electric {
+struct Needle {
+	ImVec2 position;  // In meters
+	ImVec2 field;	  // In N/C
+	float size;		  // Side of cell owned by needle, in meters
+};
+
+// Places needles on uniform net or on quadtree refined where direction or
+// magnitude of field changes the most.
+class NeedleGrid {
+   public:
+	bool adaptive = false;
+	float density = 20.0f;		 // Needles per meter of uniform net
+	int maxNeedles = 3000;		 // Limit of adaptive net
+	float angleTolerance = 0.25f;		// Allowed direction change in radians
+	float magnitudeTolerance = 0.7f;	// Allowed ln(max |E| / min |E|)
+	float minCell = 0.01f;				// Smallest cell side in meters
+
+	void update(const Scene& scene, const ImVec2& size);
+	const std::vector<Needle>& needles() const { return result; }
+
+   private:
+	struct Settings {
+		bool adaptive;
+		float density, angleTolerance, magnitudeTolerance, minCell;
+		int maxNeedles;
+		ImVec2 size;
+		bool operator==(const Settings& s) const {
+			return adaptive == s.adaptive && density == s.density &&
+				   angleTolerance == s.angleTolerance &&
+				   magnitudeTolerance == s.magnitudeTolerance &&
+				   minCell == s.minCell && maxNeedles == s.maxNeedles &&
+				   size.x == s.size.x && size.y == s.size.y;
+		}
+	};
+	struct Cell {
+		ImVec2 min;
+		float size;
+		ImVec2 corners[4];	// Field at corners: top left, right, bottom ...
+		ImVec2 center;		// Field at center
+		float error;
+		bool operator<(const Cell& c) const { return error < c.error; }
+	};
+	Settings placed = {false, 0, 0, 0, 0, 0, {0, 0}};
+	Scene lastScene;
+	std::vector<Needle> result;
+
+	void placeUniform(const Scene& scene, const ImVec2& size);
+	void placeAdaptive(const Scene& scene, const ImVec2& size);
+	float cellError(const Cell& cell) const;
+};
+}  // namespace Electric
+
+#endif
@@ -0,0 +1,157 @@
+#include "electric_field_heatmap.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "../parallel.hpp"
+
+using namespace Electric;
+
+void Heatmap::update(const Scene& scene, const ImVec2& size, float scale) {
+	// Rounded up to whole tiles, so small resizes keep evaluated samples
+	int w = std::ceil(std::max(size.x, 1.0f) / pixelStep / tileSize),
+		h = std::ceil(std::max(size.y, 1.0f) / pixelStep / tileSize);
+
+	if (w * tileSize != width || h * tileSize != height ||
+		pixelStep != evaluatedStep || scale != evaluatedScale ||
+		quantity != evaluatedQuantity) {
+		tilesX = w;
+		tilesY = h;
+		width = w * tileSize;
+		height = h * tileSize;
+		evaluatedStep = pixelStep;
+		evaluatedScale = scale;
+		evaluatedQuantity = quantity;
+		tiles.assign(tilesX * tilesY, Tile());
+		values.assign(width * height, 0.0f);
+		pixels.assign(width * height, 0);
+	} else if (scene != lastScene) {
+		float floor = maxValue * (logScale ? std::pow(10.0f, -decades)
+										   : 1.0f / 256);
+		for (int t = 0; t < (int)tiles.size(); t++) {
+			Tile& tile = tiles[t];
+			if (tile.dirty) continue;
+			ImVec2 min, max;
+			tileRect(t, min, max);
+			tile.change += scene.changeBound(lastScene, min, max,
+											 quantity == potential);
+			if (tile.change > changeTolerance * std::max(tile.minValue, floor))
+				tile.dirty = true;
+		}
+	}
+	lastScene = scene;
+
+	Coloring coloring = {colorMap, quantity, logScale, decades, maxValue};
+	bool recolor = !(coloring == colored);
+	if (recolor) {
+		colored = coloring;
+		buildPalette();
+	}
+
+	std::vector<int> dirty;
+	for (int t = 0; t < (int)tiles.size(); t++)
+		if (tiles[t].dirty) dirty.push_back(t);
+
+	parallelFor(dirty.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			evaluateTile(scene, dirty[i]);
+			if (!recolor) colorTile(dirty[i]);
+		}
+	});
+	if (recolor) {
+		parallelFor(tiles.size(), [&](size_t begin, size_t end) {
+			for (size_t t = begin; t < end; t++) colorTile(t);
+		});
+	}
+
+	if (recolor || !dirty.empty() || texture.empty())
+		texture.upload(pixels.data(), width, height);
+}
+
+void Heatmap::draw(ImDrawList* drawList, const ImVec2& origin) const {
+	if (texture.empty()) return;
+	drawList->AddImage(texture.id(), origin,
+					   ImVec2(origin.x + width * evaluatedStep,
+							  origin.y + height * evaluatedStep),
+					   ImVec2(0, 0), ImVec2(1, 1),
+					   ImColor(1.0f, 1.0f, 1.0f, opacity));
+}
+
+void Heatmap::buildPalette() {
+	static const uint8_t stops[][5][3] = {
+		{{0, 0, 0}, {120, 0, 0}, {230, 40, 0}, {255, 210, 0}, {255, 255, 255}},
+		{{68, 1, 84}, {59, 82, 139}, {33, 145, 140}, {94, 201, 98},
+		 {253, 231, 37}},
+		{{0, 0, 0}, {64, 64, 64}, {128, 128, 128}, {191, 191, 191},
+		 {255, 255, 255}},
+		{{33, 102, 172}, {146, 197, 222}, {247, 247, 247}, {244, 165, 130},
+		 {178, 24, 43}}};
+	const uint8_t(*map)[3] = stops[colorMap];
+	for (int i = 0; i < 256; i++) {
+		float pos = i / 255.0f * 4;
+		int s = std::min((int)pos, 3);
+		float t = pos - s;
+		uint32_t rgb = 0xFF000000;
+		for (int c = 0; c < 3; c++) {
+			uint32_t v = map[s][c] + (map[s + 1][c] - map[s][c]) * t + 0.5f;
+			rgb |= v << (16 - 8 * c);
+		}
+		palette[i] = rgb;
+	}
+}
+
+void Heatmap::tileRect(int tile, ImVec2& min, ImVec2& max) const {
+	float step = evaluatedStep / evaluatedScale;
+	int tx = tile % tilesX, ty = tile / tilesX;
+	min = ImVec2(tx * tileSize * step, ty * tileSize * step);
+	max = ImVec2(min.x + tileSize * step, min.y + tileSize * step);
+}
+
+void Heatmap::evaluateTile(const Scene& scene, int tile) {
+	float step = evaluatedStep / evaluatedScale;
+	int x0 = (tile % tilesX) * tileSize, y0 = (tile / tilesX) * tileSize;
+	float minValue = INFINITY;
+	for (int y = y0; y < y0 + tileSize; y++) {
+		for (int x = x0; x < x0 + tileSize; x++) {
+			ImVec2 loc((x + 0.5f) * step, (y + 0.5f) * step);
+			float v;
+			if (evaluatedQuantity == potential) {
+				v = scene.potentialAt(loc);
+			} else {
+				ImVec2 e = scene.fieldAt(loc);
+				v = std::sqrt(e.x * e.x + e.y * e.y);
+			}
+			values[y * width + x] = v;
+			minValue = std::min(minValue, std::fabs(v));
+		}
+	}
+	tiles[tile].minValue = minValue;
+	tiles[tile].change = 0.0f;
+	tiles[tile].dirty = false;
+}
+
+void Heatmap::colorTile(int tile) {
+	int x0 = (tile % tilesX) * tileSize, y0 = (tile / tilesX) * tileSize;
+	// Zero or negative scale would give infinite or NaN palette index
+	float invMax = 1.0f / std::max(colored.maxValue, FLT_MIN);
+	for (int y = y0; y < y0 + tileSize; y++) {
+		for (int x = x0; x < x0 + tileSize; x++) {
+			float v = values[y * width + x];
+			float m = std::fabs(v) * invMax;
+			if (colored.logScale)
+				m = m > 0 ? std::log10(m) / colored.decades + 1.0f : 0.0f;
+			if (!std::isfinite(m)) m = 0.0f;
+			m = std::min(std::max(m, 0.0f), 1.0f);
+			// Potential keeps its sign, centered in the middle of color map
+			float t = colored.quantity == potential
+						  ? 0.5f + (v < 0 ? -0.5f : 0.5f) * m
+						  : m;
+			pixels[y * width + x] = palette[(int)(t * 255 + 0.5f)];
+		}
+	}
+}
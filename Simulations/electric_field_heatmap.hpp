@@ -0,0 +1,70 @@
+#ifndef ELECTRIC_FIELD_HEATMAP_H
+#define ELECTRIC_FIELD_HEATMAP_H
+
+#include <imgui.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "../texture.hpp"
+#include "electric_field_scene.hpp"
+
+namespace Electric {
+// Field strength or potential rendered per sample into texture. Samples are
+// grouped in tiles and only tiles which scene change could recolor are
+// evaluated again.
+class Heatmap {
+   public:
+	enum Quantity { strength, potential };
+	enum ColorMap { heat, viridis, grayscale, diverging };
+	Quantity quantity = strength;
+	ColorMap colorMap = heat;
+	bool logScale = true;
+	float decades = 4.0f;	 // Range of logarithmic scale in powers of ten
+	float maxValue = 1.0f;	 // Value mapped to end of color map
+	int pixelStep = 2;		 // Screen pixels per one evaluated sample
+	float opacity = 0.8f;	 // <0, 1>
+
+	void update(const Scene& scene, const ImVec2& size, float scale);
+	void draw(ImDrawList* drawList, const ImVec2& origin) const;
+
+   private:
+	static const int tileSize = 32;		  // Samples per side of tile
+	const float changeTolerance = 0.02f;  // Relative, about one color step
+	struct Tile {
+		float minValue = 0.0f;	// Smallest |value| at last evaluation
+		float change = 0.0f;	// Bound of change since last evaluation
+		bool dirty = true;
+	};
+	struct Coloring {
+		ColorMap colorMap;
+		Quantity quantity;
+		bool logScale;
+		float decades, maxValue;
+		bool operator==(const Coloring& c) const {
+			return colorMap == c.colorMap && quantity == c.quantity &&
+				   logScale == c.logScale && decades == c.decades &&
+				   maxValue == c.maxValue;
+		}
+	};
+
+	int width = 0, height = 0, tilesX = 0, tilesY = 0;
+	int evaluatedStep = 0;
+	float evaluatedScale = 0.0f;
+	Quantity evaluatedQuantity = strength;
+	Coloring colored = {heat, strength, true, 0.0f, 0.0f};
+	Scene lastScene;
+	std::vector<Tile> tiles;
+	std::vector<float> values;
+	std::vector<uint32_t> pixels;
+	uint32_t palette[256];
+	Texture texture;
+
+	void buildPalette();
+	void tileRect(int tile, ImVec2& min, ImVec2& max) const;
+	void evaluateTile(const Scene& scene, int tile);
+	void colorTile(int tile);
+};
+}  // namespace Electric
+
+#endif
@@ -0,0 +1,151 @@
+#include "electric_field_lines.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "../basic.hpp"
+#include "../parallel.hpp"
+
+using namespace Electric;
+
+namespace {
+const float minStep = 1e-5f, maxStep = 0.05f;  // In meters
+const int maxSteps = 20000;
+}  // namespace
+
+void FieldLines::update(const Scene& scene, const ImVec2& min,
+						const ImVec2& max) {
+	Settings settings = {linesPerCharge, tolerance, chargeRadius,
+						 maxLines,		 min,		max};
+	if (settings == traced && scene == lastScene) return;
+	traced = settings;
+	lastScene = scene;
+
+	// Seeds around every charge, count proportional to |charge|
+	float maxCharge = 0.0f;
+	for (auto& p : scene.points)
+		maxCharge = std::max(maxCharge, std::fabs(p.charge));
+	std::vector<int> counts(scene.points.size(), 0);
+	long total = 0;
+	if (maxCharge > 0) {
+		for (size_t i = 0; i < scene.points.size(); i++) {
+			float q = std::fabs(scene.points[i].charge);
+			if (q > 0)
+				counts[i] = std::max(1L, std::lround(linesPerCharge * q / maxCharge));
+			total += counts[i];
+		}
+	}
+	if (total > maxLines) {
+		for (auto& c : counts)
+			if (c > 0) c = std::max(1L, c * (long)maxLines / total);
+	}
+
+	struct Seed {
+		ImVec2 position;
+		float sign;
+		int charge;
+	};
+	std::vector<Seed> seeds;
+	for (size_t i = 0; i < scene.points.size(); i++) {
+		const PointCharge& p = scene.points[i];
+		for (int s = 0; s < counts[i]; s++) {
+			float angle = (s + 0.5f) * 2 * M_PI / counts[i];
+			seeds.push_back({{p.position.x + chargeRadius * std::cos(angle),
+							  p.position.y + chargeRadius * std::sin(angle)},
+							 p.charge > 0 ? 1.0f : -1.0f,
+							 (int)i});
+		}
+	}
+
+	lines.resize(seeds.size());
+	parallelFor(seeds.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			Seed& seed = seeds[i];
+			Line& line = lines[i];
+			line.points.clear();
+			int hit = trace(scene, seed.position, seed.sign, line.points);
+			// Lines between opposite charges are drawn from positive side
+			line.alongField = seed.sign > 0;
+			line.visible = line.alongField || hit == -1;
+		}
+	});
+}
+
+void FieldLines::draw(ImDrawList* drawList, const ImVec2& origin,
+					  float scale, ImColor color) const {
+	std::vector<ImVec2> screen;
+	for (auto& line : lines) {
+		if (!line.visible || line.points.size() < 2) continue;
+		screen.resize(line.points.size());
+		for (size_t i = 0; i < line.points.size(); i++)
+			screen[i] = ImVec2(origin.x + line.points[i].x * scale,
+							   origin.y + line.points[i].y * scale);
+		drawList->AddPolyline(screen.data(), screen.size(), color, 0, 1.5f);
+
+		// Direction arrow in the middle, always pointing along E
+		size_t middle = screen.size() / 2;
+		const ImVec2 &from = screen[middle - 1], &to = screen[middle];
+		drawArrow(line.alongField ? from : to, line.alongField ? to : from,
+				  drawList, 8.0f, 60.0f, 1.5f, color);
+	}
+}
+
+ImVec2 FieldLines::direction(const Scene& scene, const ImVec2& position,
+							 float sign) const {
+	ImVec2 e = scene.fieldAt(position);
+	float length = std::sqrt(e.x * e.x + e.y * e.y);
+	if (!(length > 0) || !std::isfinite(length)) return ImVec2(0, 0);
+	return ImVec2(sign * e.x / length, sign * e.y / length);
+}
+
+int FieldLines::trace(const Scene& scene, ImVec2 position, float sign,
+					  std::vector<ImVec2>& points) const {
+	// One RK4 step of length h along unit field direction
+	auto rk4 = [&](const ImVec2& p, float h, bool& stalled) {
+		ImVec2 k1 = direction(scene, p, sign);
+		ImVec2 k2 = direction(
+			scene, ImVec2(p.x + k1.x * h / 2, p.y + k1.y * h / 2), sign);
+		ImVec2 k3 = direction(
+			scene, ImVec2(p.x + k2.x * h / 2, p.y + k2.y * h / 2), sign);
+		ImVec2 k4 =
+			direction(scene, ImVec2(p.x + k3.x * h, p.y + k3.y * h), sign);
+		stalled = k1.x == 0 && k1.y == 0;
+		return ImVec2(p.x + h / 6 * (k1.x + 2 * k2.x + 2 * k3.x + k4.x),
+					  p.y + h / 6 * (k1.y + 2 * k2.y + 2 * k3.y + k4.y));
+	};
+
+	ImVec2 min = traced.min, max = traced.max;
+	float h = std::min(chargeRadius / 4, maxStep);
+	points.push_back(position);
+	for (int step = 0; step < maxSteps; step++) {
+		// Step doubling: compare one full step against two half steps
+		bool stalled;
+		ImVec2 full = rk4(position, h, stalled);
+		if (stalled) return -1;
+		ImVec2 half = rk4(rk4(position, h / 2, stalled), h / 2, stalled);
+		float error = distanceBetweenPoints(full, half);
+		if (error > tolerance && h > minStep) {
+			h = std::max(h / 2, minStep);
+			continue;
+		}
+		position = half;
+		points.push_back(position);
+		if (error < tolerance / 32) h = std::min(h * 2, maxStep);
+
+		if (position.x < min.x || position.x > max.x || position.y < min.y ||
+			position.y > max.y)
+			return -1;
+		for (size_t i = 0; i < scene.points.size(); i++) {
+			const PointCharge& p = scene.points[i];
+			if (p.charge * sign < 0 &&
+				distanceBetweenPoints(p.position, position) < chargeRadius) {
+				points.push_back(p.position);
+				return i;
+			}
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,56 @@
+#ifndef ELECTRIC_FIELD_LINES_H
+#define ELECTRIC_FIELD_LINES_H
+
+#include <imgui.h>
+
+#include <vector>
+
+#include "electric_field_scene.hpp"
+
+namespace Electric {
+// Field lines from positive to negative charges, traced with adaptive RK4.
+// Lines are kept until scene or settings change.
+class FieldLines {
+   public:
+	float linesPerCharge = 16.0f;  // Lines leaving the largest |charge|
+	int maxLines = 4096;
+	float tolerance = 2e-5f;  // Allowed error of one step in meters
+	float chargeRadius = 0.05f;	 // Lines start and end there, in meters
+
+	// Traces lines again if needed. Lines leaving area <min, max> end.
+	void update(const Scene& scene, const ImVec2& min, const ImVec2& max);
+	void draw(ImDrawList* drawList, const ImVec2& origin, float scale,
+			  ImColor color = ImColor(255, 255, 255)) const;
+
+   private:
+	struct Settings {
+		float linesPerCharge, tolerance, chargeRadius;
+		int maxLines;
+		ImVec2 min, max;
+		bool operator==(const Settings& s) const {
+			return linesPerCharge == s.linesPerCharge &&
+				   tolerance == s.tolerance &&
+				   chargeRadius == s.chargeRadius && maxLines == s.maxLines &&
+				   min.x == s.min.x && min.y == s.min.y && max.x == s.max.x &&
+				   max.y == s.max.y;
+		}
+	};
+	struct Line {
+		std::vector<ImVec2> points;
+		bool visible = false;
+		bool alongField = true;	 // Points are ordered in direction of E
+	};
+	Settings traced = {0, 0, 0, 0, {0, 0}, {0, 0}};
+	Scene lastScene;
+	std::vector<Line> lines;
+
+	// Follows E (sign 1) or -E (sign -1). Returns index of charge where line
+	// ended or -1.
+	int trace(const Scene& scene, ImVec2 position, float sign,
+			  std::vector<ImVec2>& points) const;
+	ImVec2 direction(const Scene& scene, const ImVec2& position,
+					 float sign) const;
+};
+}  // namespace Electric
+
+#endif
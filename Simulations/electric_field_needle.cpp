@@ -2,11 +2,23 @@
 
 #include <algorithm>
 #include <cmath>
+#include <string>
 #include <vector>
 
 #include "../basic.hpp"
 #include "../translate.hpp"
 #include "electric_field.hpp"
+#include "electric_field_contours.hpp"
+#include "electric_field_grid.hpp"
+#include "electric_field_heatmap.hpp"
+#include "electric_field_lines.hpp"
+#include "electric_field_poisson.hpp"
+#include "electric_field_scene.hpp"
+
+// Dense needle nets easily pass 2^16 vertices in one draw list
+static_assert(sizeof(ImDrawIdx) == 4, "ImDrawIdx must be 32-bit");
+
+static const float minMaster = 1e-6f;  // Least field or potential of scale
 
 void ElectricField::drawElectroMagneticNeedles() {
 	static std::vector<object> objects = {
@@ -18,6 +30,36 @@ void ElectricField::drawElectroMagneticNeedles() {
 	static int arrowLength = 25;
 	static object* lastMoved = NULL;
 	static object* editObject = NULL;
+	static Electric::Scene scene;
+	static Electric::NeedleGrid needleGrid;
+	static std::vector<ImVec2> needlePoints, needleFields;
+	static std::vector<ImU32> needleColors;
+	static std::vector<float> needleLengths;
+	static Electric::Heatmap heatmap;
+	static bool showHeatmap = false;
+	static Electric::FieldLines fieldLines;
+	static bool showFieldLines = false;
+	static Electric::Equipotentials equipotentials;
+	static bool showEquipotentials = false;
+	static bool autoPotentialStep = true;
+	static int equipotentialCount = 20;	 // Lines up to master potential
+	static Electric::PoissonGrid poissonGrid;
+	static std::vector<Electric::Conductor> conductors;
+	static bool useConductors = false;
+	static bool drawConductors = false;	 // Left mouse draws instead of moves
+	static float conductorPotential = 100.0f;  // For new conductors, in V
+	static Electric::Conductor* drawnConductor = NULL;
+	static std::vector<Electric::LineCharge> rods;
+	static std::vector<Electric::ArcCharge> arcs;
+	static std::vector<Electric::SheetCharge> plates;
+	static Electric::LineCharge* movedRod = NULL;
+	static Electric::ArcCharge* movedArc = NULL;
+	static Electric::SheetCharge* movedPlate = NULL;
+	static float lineDensity = 5e-3f;	   // For rods and arcs, in C/m
+	static float surfaceDensity = 0.15f;  // For plates, in C/m^2
+	static int distributionCount = 1000;
+	static float distributionCharge = 1.6e-3f;	// Total charge in Columbs
+	static float distributionRadius = 0.1f;		// In meters
 
 	ImGui::Begin(tr("Electric charge field needle").c_str(),
 				 &isElectroMagneticNeedlesActive, ImGuiWindowFlags_MenuBar);
@@ -34,34 +76,142 @@ void ElectricField::drawElectroMagneticNeedles() {
 	mousePtr.y -= windowPos.y;
 	mousePtr.y /= scale;
 
-	// Draw Needles
-	static float maxCharge = fabs(objects[0].charge);
+	// Scale of colors from largest total charge of one source, rods, arcs
+	// and plates count too
+	float maxCharge = 0.0f;
+	for (auto& obj : objects)
+		maxCharge = std::max(maxCharge, std::fabs(obj.charge));
+	for (auto& r : rods)
+		maxCharge = std::max(
+			maxCharge,
+			std::fabs(r.density * std::hypot(r.b.x - r.a.x, r.b.y - r.a.y)));
+	for (auto& a : arcs)
+		maxCharge = std::max(
+			maxCharge, std::fabs(a.density * a.radius * (a.end - a.start)));
+	for (auto& p : plates)
+		maxCharge = std::max(maxCharge, std::fabs(p.density *
+												  (p.max.x - p.min.x) *
+												  (p.max.y - p.min.y)));
 	float masterColorForce =
 		(this->k / std::pow(objectSize * 1.5, 2)) * maxCharge;
-	ImVec2 loc = ImVec2(0, 0);
-	for (; loc.x < windowSize.x; loc.x += 1 / densityOfNeedles) {
-		loc.y = 0;
-		for (; loc.y < windowSize.y; loc.y += 1 / densityOfNeedles) {
-			std::vector<Force> forces = this->calcNeedleForces(loc, objects);
-			Force data = resultantOfForces(forces);
-			float colorScale = sqrt(sqrt(data.power / masterColorForce));
-			if (colorScale > 1.0f) colorScale = 1.0f;
-			drawNeedle(
-				ImVec2(windowPos.x + loc.x * scale,
-					   windowPos.y + loc.y * scale),
-				draw, arrowLength, data.angle / M_PI * 180,
-				ImColor::HSV(colorScale, 1.0f, sqrt(colorScale))
-			);
-		}
-		if (draw->IdxBuffer.size() > std::pow(2, 16) * 0.90) {
-			densityOfNeedles *= 0.90;
+
+	float masterPotential = masterColorForce * objectSize * 1.5f;
+
+	scene.k = this->k;
+	scene.setPoints(objects);
+	scene.lines = rods;
+	scene.setArcs(arcs);
+	scene.sheets = plates;
+
+	// Conductors in grounded box, potential is solved on grid
+	scene.setGrid(NULL);
+	if (useConductors) {
+		poissonGrid.update(scene, conductors, windowSize);
+		scene.setGrid(&poissonGrid);
+		masterColorForce = poissonGrid.maxField();
+		masterPotential = poissonGrid.maxPotential();
+	}
+	// Empty scene would divide by zero
+	masterColorForce = std::max(masterColorForce, minMaster);
+	masterPotential = std::max(masterPotential, minMaster);
+
+	// Draw heatmap under needles
+	if (showHeatmap) {
+		heatmap.maxValue = heatmap.quantity == Electric::Heatmap::strength
+							   ? masterColorForce
+							   : masterPotential;
+		heatmap.update(scene,
+					   ImVec2(ImGui::GetWindowWidth(), ImGui::GetWindowHeight()),
+					   scale);
+		heatmap.draw(draw, windowPos);
+	}
+
+	needleGrid.density = densityOfNeedles;
+	needleGrid.minCell = 6.0f / scale;	// Cells stay a few pixels wide
+	needleGrid.update(scene, windowSize);
+	const std::vector<Electric::Needle>& needles = needleGrid.needles();
+	needlePoints.resize(needles.size());
+	needleColors.resize(needles.size());
+	needleLengths.resize(needles.size());
+	needleFields.resize(needles.size());
+	for (size_t i = 0; i < needles.size(); i++) {
+		const Electric::Needle& needle = needles[i];
+		float power = std::sqrt(needle.field.x * needle.field.x +
+								needle.field.y * needle.field.y);
+		float colorScale = sqrt(sqrt(power / masterColorForce));
+		if (colorScale > 1.0f) colorScale = 1.0f;
+		needleLengths[i] = arrowLength;
+		if (needleGrid.adaptive)
+			needleLengths[i] =
+				std::min(needleLengths[i], needle.size * scale * 0.9f);
+		needlePoints[i] = ImVec2(windowPos.x + needle.position.x * scale,
+								 windowPos.y + needle.position.y * scale);
+		needleFields[i] = needle.field;
+		needleColors[i] = ImColor::HSV(colorScale, 1.0f, sqrt(colorScale));
+	}
+	drawNeedles(draw, needles.size(), needlePoints.data(), needleFields.data(),
+				needleColors.data(), needleLengths.data());
+
+	// Draw equipotential lines
+	if (showEquipotentials) {
+		if (autoPotentialStep)
+			equipotentials.step = masterPotential / equipotentialCount;
+		equipotentials.update(
+			scene, ImVec2(ImGui::GetWindowWidth(), ImGui::GetWindowHeight()),
+			scale);
+		equipotentials.draw(draw, windowPos, scale);
+	}
+
+	// Draw field lines, area is extended so lines can leave and come back
+	if (showFieldLines) {
+		fieldLines.chargeRadius = objectSize;
+		fieldLines.update(scene,
+						  ImVec2(-windowSize.x / 2, -windowSize.y / 2),
+						  ImVec2(windowSize.x * 1.5f, windowSize.y * 1.5f));
+		fieldLines.draw(draw, windowPos, scale);
+	}
+
+	// Draw conductors, plates are at least 3 px thick
+	if (useConductors) {
+		for (auto& c : conductors) {
+			ImVec2 a(windowPos.x + std::min(c.min.x, c.max.x) * scale,
+					 windowPos.y + std::min(c.min.y, c.max.y) * scale),
+				b(windowPos.x + std::max(c.min.x, c.max.x) * scale,
+				  windowPos.y + std::max(c.min.y, c.max.y) * scale);
+			b.x = std::max(b.x, a.x + 3);
+			b.y = std::max(b.y, a.y + 3);
+			draw->AddRectFilled(a, b,
+								c.potential > 0
+									? ImColor(255, 110, 110)
+									: (c.potential == 0 ? ImColor(160, 160, 160)
+														: ImColor(110, 110, 255)));
 		}
 	}
 
-	// Find maximum object charge
-	maxCharge = 0.0f;
-	for (auto& obj : objects)
-		if (fabs(obj.charge) > maxCharge) maxCharge = fabs(obj.charge);
+	// Draw rods, arcs and plates
+	auto sourceColor = [](float density, int alpha) {
+		return density > 0 ? ImColor(255, 0, 0, alpha)
+						   : (density == 0 ? ImColor(255, 255, 255, alpha)
+										   : ImColor(0, 0, 255, alpha));
+	};
+	for (auto& r : rods)
+		draw->AddLine(ImVec2(windowPos.x + r.a.x * scale,
+							 windowPos.y + r.a.y * scale),
+					  ImVec2(windowPos.x + r.b.x * scale,
+							 windowPos.y + r.b.y * scale),
+					  sourceColor(r.density, 255), 4.0f);
+	for (auto& a : arcs) {
+		draw->PathArcTo(ImVec2(windowPos.x + a.center.x * scale,
+							   windowPos.y + a.center.y * scale),
+						a.radius * scale, a.start, a.end);
+		draw->PathStroke(sourceColor(a.density, 255), 0, 4.0f);
+	}
+	for (auto& p : plates)
+		draw->AddRectFilled(ImVec2(windowPos.x + p.min.x * scale,
+								   windowPos.y + p.min.y * scale),
+							ImVec2(windowPos.x + p.max.x * scale,
+								   windowPos.y + p.max.y * scale),
+							sourceColor(p.density, 140));
 
 	// Draw objects
 	for (auto& obj : objects) {
@@ -74,21 +224,80 @@ void ElectricField::drawElectroMagneticNeedles() {
 													 : ImColor(0, 0, 255)));
 	}
 
+	// Draw new conductor
+	if (useConductors && drawConductors) {
+		if (ImGui::IsMouseClicked(ImGuiMouseButton_Left) &&
+			ImGui::IsWindowHovered()) {
+			conductors.push_back(
+				Electric::Conductor{mousePtr, mousePtr, conductorPotential});
+			drawnConductor = &conductors.back();
+		}
+		if (drawnConductor != NULL) {
+			if (ImGui::IsMouseDown(ImGuiMouseButton_Left)) {
+				drawnConductor->max = mousePtr;
+			} else {
+				drawnConductor = NULL;
+			}
+		}
+	}
+
 	// Move objects
-	if (ImGui::IsMouseClicked(ImGuiMouseButton_Left) && lastMoved == NULL) {
+	if (ImGui::IsMouseClicked(ImGuiMouseButton_Left) && lastMoved == NULL &&
+		!(useConductors && drawConductors)) {
 		for (auto& obj : objects) {
 			if (distanceBetweenPoints(obj.position, mousePtr) <= objectSize) {
 				lastMoved = &obj;
 			}
 		}
+		for (auto& r : rods) {
+			ImVec2 d(r.b.x - r.a.x, r.b.y - r.a.y);
+			float t =
+				((mousePtr.x - r.a.x) * d.x + (mousePtr.y - r.a.y) * d.y) /
+				std::max(d.x * d.x + d.y * d.y, 1e-12f);
+			t = std::min(std::max(t, 0.0f), 1.0f);
+			if (distanceBetweenPoints(
+					ImVec2(r.a.x + d.x * t, r.a.y + d.y * t), mousePtr) <=
+				objectSize / 2)
+				movedRod = &r;
+		}
+		for (auto& a : arcs) {
+			float angle = std::atan2(mousePtr.y - a.center.y,
+									 mousePtr.x - a.center.x);
+			angle = a.start + std::fmod(angle - a.start + 4 * M_PI, 2 * M_PI);
+			if (std::fabs(distanceBetweenPoints(a.center, mousePtr) -
+						  a.radius) <= objectSize / 2 &&
+				angle <= a.end)
+				movedArc = &a;
+		}
+		for (auto& p : plates)
+			if (mousePtr.x >= p.min.x && mousePtr.x <= p.max.x &&
+				mousePtr.y >= p.min.y && mousePtr.y <= p.max.y)
+				movedPlate = &p;
 	}
 	if (ImGui::IsMouseDown(ImGuiMouseButton_Left)) {
+		ImVec2 delta(io.MouseDelta.x / scale, io.MouseDelta.y / scale);
 		if (lastMoved != NULL) {
-			lastMoved->position.x += io.MouseDelta.x / scale;
-			lastMoved->position.y += io.MouseDelta.y / scale;
+			lastMoved->position.x += delta.x;
+			lastMoved->position.y += delta.y;
+		} else if (movedRod != NULL) {
+			movedRod->a.x += delta.x;
+			movedRod->a.y += delta.y;
+			movedRod->b.x += delta.x;
+			movedRod->b.y += delta.y;
+		} else if (movedArc != NULL) {
+			movedArc->center.x += delta.x;
+			movedArc->center.y += delta.y;
+		} else if (movedPlate != NULL) {
+			movedPlate->min.x += delta.x;
+			movedPlate->min.y += delta.y;
+			movedPlate->max.x += delta.x;
+			movedPlate->max.y += delta.y;
 		}
 	} else {
 		lastMoved = NULL;
+		movedRod = NULL;
+		movedArc = NULL;
+		movedPlate = NULL;
 	}
 
 	// Popup Menu for editing objects
@@ -131,6 +340,20 @@ void ElectricField::drawElectroMagneticNeedles() {
 			ImGui::DragFloat(tr("Density of needles").c_str(),
 							 &densityOfNeedles, 0.1f, 1.0f, 60.0f, "%.1f 1/m",
 							 ImGuiSliderFlags_AlwaysClamp);
+			ImGui::Checkbox(tr("Adaptive grid").c_str(), &needleGrid.adaptive);
+			if (needleGrid.adaptive) {
+				ImGui::DragInt(tr("Maximum needles").c_str(),
+							   &needleGrid.maxNeedles, 10.0f, 16, 100000, "%d",
+							   ImGuiSliderFlags_AlwaysClamp);
+				float angle = needleGrid.angleTolerance / M_PI * 180;
+				if (ImGui::DragFloat(tr("Angle tolerance").c_str(), &angle,
+									 0.1f, 1.0f, 90.0f, "%.1f°",
+									 ImGuiSliderFlags_AlwaysClamp))
+					needleGrid.angleTolerance = angle / 180 * M_PI;
+				ImGui::DragFloat(tr("Magnitude tolerance").c_str(),
+								 &needleGrid.magnitudeTolerance, 0.01f, 0.05f,
+								 5.0f, "%.2f", ImGuiSliderFlags_AlwaysClamp);
+			}
 			ImGui::DragFloat(tr("Scale").c_str(), &scale, 1.0f, 10.0f,
 							 1000000.0f, "%.0f m/px",
 							 ImGuiSliderFlags_AlwaysClamp);
@@ -139,6 +362,225 @@ void ElectricField::drawElectroMagneticNeedles() {
 							 ImGuiSliderFlags_AlwaysClamp);
 			ImGui::DragInt(tr("Arrow size").c_str(), &arrowLength, 1, 3, 100,
 						   "%d px", ImGuiSliderFlags_AlwaysClamp);
+			ImGui::DragFloat(tr("Multipole accuracy").c_str(), &scene.accuracy,
+							 0.01f, 0.0f, Electric::Scene::maxAccuracy, "%.2f",
+							 ImGuiSliderFlags_AlwaysClamp);
+			ImGui::EndMenu();
+		}
+		if (ImGui::BeginMenu(tr("Charges").c_str())) {
+			ImGui::DragInt(tr("Count").c_str(), &distributionCount, 10.0f, 2,
+						   20000, "%d", ImGuiSliderFlags_AlwaysClamp);
+			ImGui::DragFloat(tr("Total charge").c_str(), &distributionCharge,
+							 4e-6f, -4.0f, 4.0f, "%.6f C",
+							 ImGuiSliderFlags_AlwaysClamp);
+			ImGui::DragFloat(tr("Radius").c_str(), &distributionRadius,
+							 0.005f, 0.01f, 10.0f, "%.3f m",
+							 ImGuiSliderFlags_AlwaysClamp);
+			bool ring = ImGui::Button(tr("Add charged ring").c_str());
+			ImGui::SameLine();
+			bool cloud = ImGui::Button(tr("Add charge cloud").c_str());
+			if (ring || cloud) {
+				ImVec2 center(windowSize.x / 2, windowSize.y / 2);
+				for (int i = 0; i < distributionCount; i++) {
+					float angle = 2 * M_PI * i / distributionCount,
+						  radius = distributionRadius;
+					if (cloud) {  // Evenly filled disc, golden angle spiral
+						angle = i * 2.39996323f;
+						radius *= std::sqrt((i + 0.5f) / distributionCount);
+					}
+					objects.push_back(
+						object{{center.x + radius * std::cos(angle),
+								center.y + radius * std::sin(angle)},
+							   {0, 0},
+							   0,
+							   0,
+							   distributionCharge / distributionCount,
+							   {}});
+				}
+				lastMoved = editObject = NULL;
+			}
+
+			// Sources with closed form field
+			ImGui::Separator();
+			ImGui::DragFloat(tr("Line density").c_str(), &lineDensity, 1e-5f,
+							 -1.0f, 1.0f, "%.5f C/m",
+							 ImGuiSliderFlags_AlwaysClamp);
+			ImGui::DragFloat(tr("Surface density").c_str(), &surfaceDensity,
+							 1e-4f, -10.0f, 10.0f, "%.4f C/m²",
+							 ImGuiSliderFlags_AlwaysClamp);
+			ImVec2 center(windowSize.x / 2, windowSize.y / 2);
+			if (ImGui::Button(tr("Add rod").c_str())) {
+				rods.push_back(Electric::LineCharge{
+					{center.x - distributionRadius, center.y},
+					{center.x + distributionRadius, center.y},
+					lineDensity});
+				movedRod = NULL;
+			}
+			ImGui::SameLine();
+			if (ImGui::Button(tr("Add arc").c_str())) {
+				arcs.push_back(Electric::ArcCharge{center, distributionRadius,
+												   (float)M_PI, 2 * (float)M_PI,
+												   lineDensity});
+				movedArc = NULL;
+			}
+			ImGui::SameLine();
+			if (ImGui::Button(tr("Add plate").c_str())) {
+				plates.push_back(Electric::SheetCharge{
+					{center.x - distributionRadius, center.y - objectSize / 2},
+					{center.x + distributionRadius, center.y + objectSize / 2},
+					surfaceDensity});
+				movedPlate = NULL;
+			}
+			for (size_t i = 0; i < rods.size(); i++) {
+				ImGui::PushID(i);
+				ImGui::Text("%s %zu", tr("Rod").c_str(), i + 1);
+				ImGui::SameLine();
+				ImGui::SetNextItemWidth(120);
+				ImGui::DragFloat("##Density", &rods[i].density, 1e-5f, -1.0f,
+								 1.0f, "%.5f C/m",
+								 ImGuiSliderFlags_AlwaysClamp);
+				ImGui::SameLine();
+				if (ImGui::Button(tr("Remove").c_str())) {
+					rods.erase(rods.begin() + i);
+					movedRod = NULL;
+				}
+				ImGui::PopID();
+			}
+			for (size_t i = 0; i < arcs.size(); i++) {
+				ImGui::PushID(rods.size() + i);
+				ImGui::Text("%s %zu", tr("Arc").c_str(), i + 1);
+				ImGui::SameLine();
+				ImGui::SetNextItemWidth(120);
+				ImGui::DragFloat("##Density", &arcs[i].density, 1e-5f, -1.0f,
+								 1.0f, "%.5f C/m",
+								 ImGuiSliderFlags_AlwaysClamp);
+				ImGui::SameLine();
+				if (ImGui::Button(tr("Remove").c_str())) {
+					arcs.erase(arcs.begin() + i);
+					movedArc = NULL;
+				}
+				ImGui::PopID();
+			}
+			for (size_t i = 0; i < plates.size(); i++) {
+				ImGui::PushID(rods.size() + arcs.size() + i);
+				ImGui::Text("%s %zu", tr("Plate").c_str(), i + 1);
+				ImGui::SameLine();
+				ImGui::SetNextItemWidth(120);
+				ImGui::DragFloat("##Density", &plates[i].density, 1e-4f,
+								 -10.0f, 10.0f, "%.4f C/m²",
+								 ImGuiSliderFlags_AlwaysClamp);
+				ImGui::SameLine();
+				if (ImGui::Button(tr("Remove").c_str())) {
+					plates.erase(plates.begin() + i);
+					movedPlate = NULL;
+				}
+				ImGui::PopID();
+			}
+
+			ImGui::Separator();
+			if (ImGui::Button(tr("Remove all").c_str())) {
+				objects.clear();
+				rods.clear();
+				arcs.clear();
+				plates.clear();
+				lastMoved = editObject = NULL;
+				movedRod = NULL;
+				movedArc = NULL;
+				movedPlate = NULL;
+			}
+			ImGui::EndMenu();
+		}
+		if (ImGui::BeginMenu(tr("Conductors").c_str())) {
+			ImGui::Checkbox(tr("Conductors in grounded box").c_str(),
+							&useConductors);
+			ImGui::Checkbox(tr("Draw conductors").c_str(), &drawConductors);
+			ImGui::DragFloat(tr("Potential").c_str(), &conductorPotential,
+							 1.0f, -1e6f, 1e6f, "%.1f V",
+							 ImGuiSliderFlags_AlwaysClamp);
+
+			const char* resolutions[] = {"64", "128", "256", "512"};
+			int resolution = std::log2(poissonGrid.cells / 64);
+			if (ImGui::Combo(tr("Grid resolution").c_str(), &resolution,
+							 resolutions, IM_ARRAYSIZE(resolutions)))
+				poissonGrid.cells = 64 << resolution;
+			ImGui::DragInt(tr("V-cycles per frame").c_str(),
+						   &poissonGrid.cyclesPerUpdate, 0.1f, 1, 32, "%d",
+						   ImGuiSliderFlags_AlwaysClamp);
+			ImGui::Text("%s: %.1e (%d)", tr("Residual").c_str(),
+						poissonGrid.residual(), poissonGrid.cycles());
+
+			for (size_t i = 0; i < conductors.size(); i++) {
+				ImGui::PushID(i);
+				ImGui::SetNextItemWidth(120);
+				ImGui::DragFloat("##Potential", &conductors[i].potential, 1.0f,
+								 -1e6f, 1e6f, "%.1f V",
+								 ImGuiSliderFlags_AlwaysClamp);
+				ImGui::SameLine();
+				if (ImGui::Button(tr("Remove").c_str())) {
+					conductors.erase(conductors.begin() + i);
+					drawnConductor = NULL;
+				}
+				ImGui::PopID();
+			}
+			ImGui::EndMenu();
+		}
+		if (ImGui::BeginMenu(tr("Field lines").c_str())) {
+			ImGui::Checkbox(tr("Show field lines").c_str(), &showFieldLines);
+			ImGui::DragFloat(tr("Lines per charge").c_str(),
+							 &fieldLines.linesPerCharge, 0.2f, 1.0f, 512.0f,
+							 "%.0f", ImGuiSliderFlags_AlwaysClamp);
+			ImGui::DragFloat(
+				tr("Step tolerance").c_str(), &fieldLines.tolerance, 1e-6f,
+				1e-7f, 1e-2f, "%.1e m",
+				ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_AlwaysClamp);
+			ImGui::EndMenu();
+		}
+		if (ImGui::BeginMenu(tr("Equipotentials").c_str())) {
+			ImGui::Checkbox(tr("Show equipotentials").c_str(),
+							&showEquipotentials);
+			ImGui::Checkbox(tr("Automatic step").c_str(), &autoPotentialStep);
+			if (autoPotentialStep) {
+				ImGui::SliderInt(tr("Lines").c_str(), &equipotentialCount, 1,
+								 100, "%d", ImGuiSliderFlags_AlwaysClamp);
+			} else {
+				ImGui::DragFloat(tr("Potential step").c_str(),
+								 &equipotentials.step, equipotentials.step / 50,
+								 1e-3f, 1e12f, "%.3g V",
+								 ImGuiSliderFlags_Logarithmic |
+									 ImGuiSliderFlags_AlwaysClamp);
+			}
+			ImGui::SliderInt(tr("Resolution").c_str(),
+							 &equipotentials.pixelStep, 2, 16, "%d px",
+							 ImGuiSliderFlags_AlwaysClamp);
+			ImGui::EndMenu();
+		}
+		if (ImGui::BeginMenu(tr("Heatmap").c_str())) {
+			ImGui::Checkbox(tr("Show heatmap").c_str(), &showHeatmap);
+
+			std::string strength = tr("Field strength"),
+						potential = tr("Potential");
+			const char* quantities[] = {strength.c_str(), potential.c_str()};
+			int quantity = heatmap.quantity;
+			if (ImGui::Combo(tr("Quantity").c_str(), &quantity, quantities,
+							 IM_ARRAYSIZE(quantities)))
+				heatmap.quantity = (Electric::Heatmap::Quantity)quantity;
+
+			std::string heat = tr("Heat"), grayscale = tr("Grayscale"),
+						diverging = tr("Diverging");
+			const char* colorMaps[] = {heat.c_str(), "Viridis",
+									   grayscale.c_str(), diverging.c_str()};
+			int colorMap = heatmap.colorMap;
+			if (ImGui::Combo(tr("Color map").c_str(), &colorMap, colorMaps,
+							 IM_ARRAYSIZE(colorMaps)))
+				heatmap.colorMap = (Electric::Heatmap::ColorMap)colorMap;
+
+			ImGui::Checkbox(tr("Logarithmic scale").c_str(), &heatmap.logScale);
+			ImGui::DragFloat(tr("Decades").c_str(), &heatmap.decades, 0.05f,
+							 1.0f, 10.0f, "%.1f", ImGuiSliderFlags_AlwaysClamp);
+			ImGui::SliderInt(tr("Resolution").c_str(), &heatmap.pixelStep, 1,
+							 16, "%d px", ImGuiSliderFlags_AlwaysClamp);
+			ImGui::SliderFloat(tr("Opacity").c_str(), &heatmap.opacity, 0.0f,
+							   1.0f, "%.2f", ImGuiSliderFlags_AlwaysClamp);
 			ImGui::EndMenu();
 		}
 		ImGui::EndMenuBar();
@@ -146,21 +588,4 @@ void ElectricField::drawElectroMagneticNeedles() {
 
 	draw->PushClipRectFullScreen();
 	ImGui::End();
-}
-
-std::vector<Force> ElectricField::calcNeedleForces(
-	const ImVec2& location, std::vector<object>& objects) {
-	std::vector<Force> forces;
-	for (auto& obj : objects) {
-		Force objForce(
-			(this->k /
-			 std::pow(distanceBetweenPoints(obj.position, location), 2)) *
-				obj.charge,
-			angleBetweenPoints(location, obj.position));
-		if (obj.charge == 0) {
-			objForce.angle = 0;
-		}  // Probablly useless feture
-		forces.push_back(objForce);
-	}
-	return forces;
 }
\ No newline at end of file
@@ -5,41 +5,28 @@
 #include <vector>
 
 #include "electric_field.hpp"
+#include "electric_field_pendulums.hpp"
 
 using namespace std;
 
-struct ballObject : object {
-	ballObject(){};
-	ImVec2 neutralPosition = {
-		0, 0};	// Default position of ball when additional forces doesn't work.
-	float angleOfLine = 0.0f;  // Angle of line maked with neutral position
-	float radius = 0.05f;	   // Radius of ball. In meters.
-};
-
 void ElectricField::drawElectroMagneticPendulum() {
 	static float scaleX = 500.0f;	 // ScaleX px = 1m
 	static float scaleY = 500.0f;	 // ScaleY px = 1m
 	static float scaleForce = 4.0f;	 // ScaleForce px = 1N
-	static vector<ballObject> objects;
+	static Electric::Pendulums balls;
 	static bool _oneTimeInitializationProcess = []() {
-		ballObject obj1;
-		obj1.neutralPosition = {0.2f, 0.3f};
-		obj1.mass = 1.0f;
-		obj1.charge = 4e-6f;
-		obj1.radius = 0.04f;
-
-		ballObject obj2;
-		obj2.neutralPosition = {0.602f, 0.273f};
-		obj2.mass = 1.7f;
-		obj2.charge = -5e-6f;
-		obj2.radius = 0.047f;
-
-		objects.push_back(obj1);
-		objects.push_back(obj2);
+		balls.add(0.2f, 0.6f, 1.0f, 4e-6f, 0.04f);
+		balls.add(0.602f, 0.546f, 1.7f, -5e-6f, 0.047f);
+		balls.refresh();
 		return true;
 	}();
-	static float gravity = 9.81;  // Meters per squere second
 	static float lastUpdate = ImGui::GetTime();
+	static bool showForces = true;
+	static const size_t maxDrawnForces = 256;  // More arrows hide balls
+	static int generatorCount = 100;
+	static int generatorRows = 10;
+	static float generatorSpacing = 0.02f;	// In meters
+	static float generatorCharge = 1e-7f;	// In Columbs
 
 	ImGui::Begin(tr("Electric pendulum").c_str(),
 				 &this->isElectroMagneticPendulumActive,
@@ -57,137 +44,81 @@ void ElectricField::drawElectroMagneticPendulum() {
 	mousePtr.y /= scaleY;
 
 	// Objects menu
-	static ballObject* menuObject = NULL;
+	static bool menuOpen = false;
+	static size_t menuObject = 0;
 	if (ImGui::BeginPopupModal(
 			"ModifyObject", NULL,
 			ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize)) {
-		if (menuObject == NULL) {
-			ballObject newObject;
-			newObject.neutralPosition = mousePtr;
-			objects.push_back(newObject);
-			menuObject = &objects.back();
+		if (!menuOpen) {
+			menuObject = balls.add(mousePtr.x, mousePtr.y, 1.0f, 0.0f, 0.05f);
+			balls.refresh();
+			menuOpen = true;
 		}
 		ImGui::SetWindowSize({300, 120});
 		ImGui::Text("%s:", tr("Charge").c_str());
-		ImGui::InputFloat("", &(menuObject->charge), 1e-6f, 1.0f, "%.3e C");
+		ImGui::InputFloat("", &balls.charge[menuObject], 1e-6f, 1.0f,
+						  "%.3e C");
 		if (ImGui::Button(tr("Remove").c_str())) {
-			auto iter = find(objects.begin(), objects.end(), *menuObject);
-			objects.erase(iter);
-			menuObject = NULL;
+			balls.remove(menuObject);
+			menuOpen = false;
 			ImGui::CloseCurrentPopup();
 		}
 		ImGui::SameLine();
 		if (ImGui::Button(tr("Close").c_str())) {
-			menuObject = NULL;
+			menuOpen = false;
 			ImGui::CloseCurrentPopup();
 		}
 		ImGui::EndPopup();
 	}
 	if (ImGui::IsMouseDown(ImGuiMouseButton_Right)) {
-		for (auto& obj : objects) {
-			if (distanceBetweenPoints(obj.position, mousePtr) <= obj.radius) {
-				menuObject = &obj;
+		for (size_t i = 0; i < balls.size(); i++) {
+			if (distanceBetweenPoints(balls.position[i], mousePtr) <=
+				balls.radius[i]) {
+				menuObject = i;
+				menuOpen = true;
 			}
 		}
 		ImGui::OpenPopup("ModifyObject");
 	}
 
-	// Get objects position
-	for (auto& obj : objects) {
-		obj.position.x = obj.neutralPosition.x +
-						 obj.neutralPosition.y * sin(obj.angleOfLine);
-		obj.position.y = obj.neutralPosition.y +
-						 obj.neutralPosition.y * cos(obj.angleOfLine);
-	}
-
-	// Calculate forces
-	for (uint8_t o1 = 0; o1 < objects.size(); o1++) {
-		auto& obj1 = objects[o1];
-		for (uint8_t o2 = o1 + 1; o2 < objects.size(); o2++) {
-			auto& obj2 = objects[o2];
-
-			float distance =
-				distanceBetweenPoints(obj1.position, obj2.position);
-
-			// Discharge and pendium reset
-			if (distance <= obj1.radius + obj2.radius) {
-				obj1.charge += obj2.charge;
-				obj1.charge /= 2;
-				obj2.charge = obj1.charge;
-
-				float pendium =
-					obj1.mass * obj1.move.x + obj2.mass * obj2.move.x;
-				pendium /= 2;
-				obj1.move.x = pendium / obj1.mass;
-				obj2.move.x = pendium / obj2.mass;
-			}
-
-			float force =
-				this->k * obj1.charge * obj2.charge / pow(distance, 2);
-			float angle = atan((obj2.position.y - obj1.position.y) /
-							   (obj2.position.x - obj1.position.x));
-
-			if (obj1.position.x > obj2.position.x) {
-				angle = -1 / angle;
-			}
-
-			obj1.forces.push_back(Force(force, angle));
-			obj2.forces.push_back(Force(force, angle + M_PI));
-		}
-		// Gravity as two parts
-		obj1.forces.push_back(
-			Force(obj1.mass * gravity * cos(obj1.angleOfLine), -M_PI / 2));
-		obj1.forces.push_back(
-			Force(obj1.mass * gravity * sin(obj1.angleOfLine), 0));
-	}
-
 	// Draw lines
-	for (auto& obj : objects) {
+	for (size_t i = 0; i < balls.size(); i++) {
 		drawL->AddLine(
-			ImVec2(windowPos.x + obj.neutralPosition.x * scaleX, windowPos.y),
-			ImVec2(windowPos.x + (obj.position.x * scaleX),
-				   windowPos.y + (obj.position.y * scaleY)),
+			ImVec2(windowPos.x + balls.pivotX[i] * scaleX, windowPos.y),
+			ImVec2(windowPos.x + balls.position[i].x * scaleX,
+				   windowPos.y + balls.position[i].y * scaleY),
 			ImColor(80, 0, 200), 3.0f);
 	}
 
 	// Draw objects
-	for (auto& obj : objects) {
+	for (size_t i = 0; i < balls.size(); i++) {
 		drawL->AddCircleFilled(
-			ImVec2(windowPos.x + (obj.position.x * scaleX),
-				   windowPos.y + ceil(obj.position.y * scaleY)),
-			obj.radius * scaleX, ImColor(70, 200, 40));
+			ImVec2(windowPos.x + balls.position[i].x * scaleX,
+				   windowPos.y + ceil(balls.position[i].y * scaleY)),
+			balls.radius[i] * scaleX,
+			balls.charge[i] > 0
+				? ImColor(200, 70, 40)
+				: (balls.charge[i] < 0 ? ImColor(40, 70, 200)
+									   : ImColor(70, 200, 40)));
 	}
 
-	// Draw forces and make resultants
-	for (auto& obj : objects) {
-		ImVec2 basePos = ImVec2(windowPos.x + (obj.position.x * scaleX),
-								windowPos.y + ceil(obj.position.y * scaleY));
-		for (auto& f : obj.forces) {
+	// Draw resultant forces
+	if (showForces && balls.size() <= maxDrawnForces) {
+		for (size_t i = 0; i < balls.size(); i++) {
+			ImVec2 basePos =
+				ImVec2(windowPos.x + balls.position[i].x * scaleX,
+					   windowPos.y + ceil(balls.position[i].y * scaleY));
 			drawArrow(basePos,
-					  ImVec2(basePos.x - f.power * cos(f.angle) * scaleForce,
-							 basePos.y - f.power * sin(f.angle) * scaleForce),
+					  ImVec2(basePos.x + balls.force[i].x * scaleForce,
+							 basePos.y + balls.force[i].y * scaleForce),
 					  drawL);
 		}
-		Force res = resultantOfForces(obj.forces);
-		obj.forces = {res};
 	}
 
 	// Calculate displacement
 	float timeDelta = ImGui::GetTime() - lastUpdate;
-	for (auto& obj : objects) {
-		auto& force = obj.forces.back();
-		obj.move.x += -force.power / obj.mass * cos(force.angle) * timeDelta;
-		obj.position.x -= obj.neutralPosition.x;
-		obj.position.x += obj.move.x * cos(obj.angleOfLine) * timeDelta;
-		if (obj.position.x > obj.neutralPosition.y) {
-			obj.position.x =
-				(signbit(obj.position.x) ? -1 : 1) * obj.neutralPosition.y;
-			obj.move.x = 0;
-		}
-		obj.angleOfLine = asin(obj.position.x / obj.neutralPosition.y);
-
-		obj.forces.clear();
-	}
+	balls.k = this->k;
+	balls.step(timeDelta);
 	lastUpdate += timeDelta;
 
 	// Menu
@@ -199,6 +130,50 @@ void ElectricField::drawElectroMagneticPendulum() {
 							 1000000.0f);
 			ImGui::DragFloat((tr("Scale") + " Y").c_str(), &scaleY, 1.0f, 10.0f,
 							 1000000.0f);
+			ImGui::Checkbox(tr("Show forces").c_str(), &showForces);
+			ImGui::DragInt(tr("Substeps").c_str(), &balls.substeps, 0.2f, 1,
+						   256, "%d", ImGuiSliderFlags_AlwaysClamp);
+			ImGui::DragFloat(tr("Gravity").c_str(), &balls.gravity, 0.01f,
+							 0.0f, 100.0f, "%.2f m/s²",
+							 ImGuiSliderFlags_AlwaysClamp);
+			ImGui::DragFloat(tr("Damping").c_str(), &balls.damping, 0.01f,
+							 0.0f, 10.0f, "%.2f 1/s",
+							 ImGuiSliderFlags_AlwaysClamp);
+			ImGui::DragFloat(tr("Multipole accuracy").c_str(),
+							 &balls.accuracy, 0.01f, 0.0f,
+							 Electric::Scene::maxAccuracy, "%.2f",
+							 ImGuiSliderFlags_AlwaysClamp);
+			ImGui::EndMenu();
+		}
+		if (ImGui::BeginMenu(tr("Balls").c_str())) {
+			ImGui::Text("%s: %zu", tr("Count").c_str(), balls.size());
+			ImGui::DragInt(tr("Columns").c_str(), &generatorCount, 1.0f, 1,
+						   10000, "%d", ImGuiSliderFlags_AlwaysClamp);
+			ImGui::DragInt(tr("Rows").c_str(), &generatorRows, 0.2f, 1, 1000,
+						   "%d", ImGuiSliderFlags_AlwaysClamp);
+			ImGui::DragFloat(tr("Spacing").c_str(), &generatorSpacing, 0.001f,
+							 0.002f, 1.0f, "%.3f m",
+							 ImGuiSliderFlags_AlwaysClamp);
+			ImGui::DragFloat(tr("Charge").c_str(), &generatorCharge, 1e-9f,
+							 -1e-3f, 1e-3f, "%.3e C",
+							 ImGuiSliderFlags_AlwaysClamp);
+			float radius = generatorSpacing * 0.3f,
+				  firstPivot = (windowSize.x / scaleX -
+								(generatorCount - 1) * generatorSpacing) /
+							   2;
+			if (ImGui::Button(tr("Add chain").c_str()))
+				balls.addChain(generatorCount, firstPivot, generatorSpacing,
+							   windowSize.y / scaleY * 0.5f, 0.01f,
+							   generatorCharge, radius);
+			ImGui::SameLine();
+			if (ImGui::Button(tr("Add lattice").c_str()))
+				balls.addLattice(generatorCount, generatorRows, firstPivot,
+								 generatorSpacing, windowSize.y / scaleY * 0.3f,
+								 0.01f, generatorCharge, radius);
+			if (ImGui::Button(tr("Remove all").c_str())) {
+				balls.clear();
+				menuOpen = false;
+			}
 			ImGui::EndMenu();
 		}
 		ImGui::EndMenuBar();
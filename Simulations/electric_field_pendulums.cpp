@@ -0,0 +1,241 @@
+#include "electric_field_pendulums.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "../parallel.hpp"
+
+using namespace Electric;
+
+namespace {
+template <class T>
+void eraseAt(std::vector<T>& v, size_t index) {
+	v.erase(v.begin() + index);
+}
+}  // namespace
+
+size_t Pendulums::add(float pivotX, float length, float mass, float charge,
+					  float radius, float angle) {
+	this->pivotX.push_back(pivotX);
+	this->length.push_back(std::max(length, 1e-3f));
+	this->mass.push_back(mass);
+	this->charge.push_back(charge);
+	this->radius.push_back(radius);
+	this->angle.push_back(angle);
+	speed.push_back(0.0f);
+	position.push_back(ImVec2(0, 0));
+	force.push_back(ImVec2(0, 0));
+	charges.push_back(PointCharge());
+	order.push_back(size() - 1);
+	return size() - 1;
+}
+
+void Pendulums::remove(size_t index) {
+	eraseAt(pivotX, index);
+	eraseAt(length, index);
+	eraseAt(mass, index);
+	eraseAt(charge, index);
+	eraseAt(radius, index);
+	eraseAt(angle, index);
+	eraseAt(speed, index);
+	eraseAt(position, index);
+	eraseAt(force, index);
+	eraseAt(charges, index);
+	order.erase(std::find(order.begin(), order.end(), index));
+	for (auto& i : order)
+		if (i > index) i--;
+}
+
+void Pendulums::clear() {
+	pivotX.clear();
+	length.clear();
+	mass.clear();
+	charge.clear();
+	radius.clear();
+	angle.clear();
+	speed.clear();
+	position.clear();
+	force.clear();
+	charges.clear();
+	order.clear();
+}
+
+void Pendulums::addChain(size_t count, float firstPivot, float spacing,
+						 float length, float mass, float charge,
+						 float radius) {
+	for (size_t i = 0; i < count; i++)
+		add(firstPivot + i * spacing, length, mass, charge, radius);
+	refresh();
+}
+
+void Pendulums::addLattice(size_t columns, size_t rows, float firstPivot,
+						   float spacing, float length, float mass,
+						   float charge, float radius) {
+	for (size_t r = 0; r < rows; r++)
+		for (size_t c = 0; c < columns; c++)
+			add(firstPivot + c * spacing, length + r * spacing, mass,
+				(r + c) % 2 ? -charge : charge, radius);
+	refresh();
+}
+
+void Pendulums::step(float frameTime) {
+	float dt = std::min(std::max(frameTime, 0.0f), maxFrame) /
+			   std::max(substeps, 1);
+	for (int s = 0; s < substeps; s++) {
+		updatePositions();
+		discharge();
+		updateForces();
+		// Semi-implicit Euler, tangential force turns string
+		parallelFor(
+			size(),
+			[this, dt](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++) {
+					float c = std::cos(angle[i]), s = std::sin(angle[i]);
+					float tangential = force[i].x * c - force[i].y * s;
+					speed[i] += (tangential / (mass[i] * length[i]) -
+								 damping * speed[i]) *
+								dt;
+					angle[i] += speed[i] * dt;
+				}
+			},
+			256);
+	}
+	refresh();
+}
+
+void Pendulums::refresh() {
+	updatePositions();
+	sortByColumn(true);
+	updateForces();
+}
+
+void Pendulums::updatePositions() {
+	for (size_t i = 0; i < size(); i++)
+		position[i] = ImVec2(pivotX[i] + length[i] * std::sin(angle[i]),
+							 length[i] * std::cos(angle[i]));
+}
+
+void Pendulums::updateForces() {
+	size_t n = size();
+	if (n >= treeThreshold && accuracy > 0) {
+		for (size_t i = 0; i < n; i++) {
+			charges[i].position = position[i];
+			charges[i].charge = charge[i];
+		}
+		tree.rebuild(charges);
+	}
+	parallelFor(
+		n,
+		[this, n](size_t begin, size_t end) {
+			float minSq = minDistance * minDistance;
+			for (size_t i = begin; i < end; i++) {
+				double x = 0, y = 0;
+				if (n >= treeThreshold && accuracy > 0) {
+					// Own charge lies at sampled point and adds nothing
+					ImVec2 e = tree.fieldAt(position[i], accuracy, k,
+											minDistance);
+					x = charge[i] * e.x;
+					y = charge[i] * e.y;
+				} else {
+					for (size_t j = 0; j < n; j++) {
+						if (j == i) continue;
+						float dx = position[i].x - position[j].x,
+							  dy = position[i].y - position[j].y;
+						float rSq = std::max(dx * dx + dy * dy, minSq);
+						float power =
+							k * charge[i] * charge[j] / (rSq * std::sqrt(rSq));
+						x += power * dx;
+						y += power * dy;
+					}
+				}
+				force[i] = ImVec2(x, y + mass[i] * gravity);
+			}
+		},
+		16);
+}
+
+void Pendulums::sortByColumn(bool full) {
+	// Touching balls lie in same or neighbouring column
+	float widest = 0.0f;
+	for (float r : radius) widest = std::max(widest, 2 * r);
+	columnWidth = std::max(widest, minDistance);
+	column.resize(size());
+	for (size_t i = 0; i < size(); i++)
+		column[i] = std::floor(position[i].x / columnWidth);
+
+	auto before = [this](size_t a, size_t b) {
+		if (column[a] != column[b]) return column[a] < column[b];
+		return position[a].y - radius[a] < position[b].y - radius[b];
+	};
+	// New balls may land anywhere, insertion sort would be quadratic
+	if (full) {
+		std::sort(order.begin(), order.end(), before);
+		return;
+	}
+	for (size_t a = 1; a < order.size(); a++) {
+		size_t ball = order[a];
+		size_t b = a;
+		for (; b > 0; b--) {
+			size_t other = order[b - 1];
+			if (!before(ball, other)) break;
+			order[b] = other;
+		}
+		order[b] = ball;
+	}
+}
+
+// Only balls in same or next column overlapping along y are compared, so
+// lattice hung in columns stays near linear.
+void Pendulums::discharge() {
+	sortByColumn(false);
+	size_t next = 0;  // First candidate in column on the right
+	for (size_t a = 0; a < order.size(); a++) {
+		size_t i = order[a];
+		float top = position[i].y - radius[i],
+			  bottom = position[i].y + radius[i];
+		for (size_t b = a + 1; b < order.size(); b++) {
+			size_t j = order[b];
+			if (column[j] != column[i] || position[j].y - radius[j] > bottom)
+				break;
+			touch(i, j);
+		}
+
+		// Skipped balls end above top of this and every later ball
+		next = std::max(next, a + 1);
+		while (next < order.size()) {
+			size_t j = order[next];
+			if (column[j] > column[i] + 1 ||
+				(column[j] == column[i] + 1 &&
+				 position[j].y - radius[j] >= top - columnWidth))
+				break;
+			next++;
+		}
+		for (size_t b = next; b < order.size(); b++) {
+			size_t j = order[b];
+			if (column[j] != column[i] + 1 ||
+				position[j].y - radius[j] > bottom)
+				break;
+			touch(i, j);
+		}
+	}
+}
+
+// Touching balls share charge, approaching ones also share momentum
+void Pendulums::touch(size_t i, size_t j) {
+	float dx = position[j].x - position[i].x,
+		  dy = position[j].y - position[i].y, r = radius[i] + radius[j];
+	if (dx * dx + dy * dy > r * r) return;
+	charge[i] = charge[j] = (charge[i] + charge[j]) / 2;
+
+	float vi = speed[i] * length[i], vj = speed[j] * length[j];
+	float ci = std::cos(angle[i]), si = std::sin(angle[i]),
+		  cj = std::cos(angle[j]), sj = std::sin(angle[j]);
+	float approach = dx * (vj * cj - vi * ci) - dy * (vj * sj - vi * si);
+	if (approach >= 0) return;
+	float momentum = (mass[i] * vi + mass[j] * vj) / 2;
+	speed[i] = momentum / (mass[i] * length[i]);
+	speed[j] = momentum / (mass[j] * length[j]);
+}
@@ -0,0 +1,67 @@
+#ifndef ELECTRIC_FIELD_PENDULUMS_H
+#define ELECTRIC_FIELD_PENDULUMS_H
+
+#include <imgui.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "electric_field_scene.hpp"
+#include "electric_field_tree.hpp"
+
+namespace Electric {
+// Charged balls on massless strings hung at y = 0 and pushed by gravity and
+// Coulomb forces. Every property is kept in own array, index is ball.
+class Pendulums {
+   public:
+	float k = 8.99e9f;
+	float gravity = 9.81f;		// In m/s^2
+	float damping = 0.0f;		// In 1/s
+	int substeps = 8;			// Steps of integration in one frame
+	float maxFrame = 1 / 30.0f;	// Longer frames are slowed down, in s
+	float accuracy = 0.5f;		// Multipole accuracy for many balls
+
+	// Ball state
+	std::vector<float> pivotX, length;	// Hanging point and string, in m
+	std::vector<float> mass, charge, radius;
+	std::vector<float> angle, speed;  // From vertical and its derivative
+	// Derived from state after every step
+	std::vector<ImVec2> position, force;  // In m and N
+
+	size_t size() const { return angle.size(); }
+	size_t add(float pivotX, float length, float mass, float charge,
+			   float radius, float angle = 0.0f);
+	void remove(size_t index);
+	void clear();
+	// Balls with equal charge hung next to each other
+	void addChain(size_t count, float firstPivot, float spacing, float length,
+				  float mass, float charge, float radius);
+	// Strings of growing length, charges alternate like in ionic crystal
+	void addLattice(size_t columns, size_t rows, float firstPivot,
+					float spacing, float length, float mass, float charge,
+					float radius);
+	// Advances by frameTime split into fixed count of substeps
+	void step(float frameTime);
+	// Recomputes position and force after state was edited
+	void refresh();
+
+   private:
+	static const size_t treeThreshold = 64;	 // Fewer balls are summed
+	const float minDistance = 1e-4f;
+	std::vector<PointCharge> charges;  // Tree input
+	ChargeTree tree;
+	// Balls sorted by column and then by top edge. Swinging balls rarely
+	// pass each other, so insertion sort of previous order is almost linear.
+	std::vector<size_t> order;
+	std::vector<long> column;  // Of each ball, as wide as largest ball
+	float columnWidth = 0.0f;
+
+	void updatePositions();
+	void updateForces();
+	void sortByColumn(bool full);
+	void discharge();
+	void touch(size_t i, size_t j);
+};
+}  // namespace Electric
+
+#endif
@@ -0,0 +1,260 @@
+#include "electric_field_poisson.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace Electric;
+
+namespace {
+const int coarsestCells = 8;  // Cells along longer side of coarsest level
+}
+
+bool PoissonGrid::update(const Scene& scene,
+						 const std::vector<Conductor>& conductors,
+						 const ImVec2& size) {
+	bool resized = size.x != lastSize.x || size.y != lastSize.y ||
+				   cells != lastCells || levels.empty();
+	bool changed = resized || scene.k != lastK ||
+				   !scene.sameSources(lastSources) ||
+				   conductors != lastConductors;
+	if (resized) allocate(size);
+	if (changed) {
+		lastSize = size;
+		lastCells = cells;
+		lastK = scene.k;
+		lastSources = scene;
+		lastConductors = conductors;
+		setSources(scene, conductors);
+		cyclesSinceChange = 0;
+		lastResidual = computeResidual(levels[0]) / rhsNorm;
+	}
+	bool solved = false;
+	for (int c = 0; c < cyclesPerUpdate && lastResidual > tolerance; c++) {
+		cycle(0);
+		cyclesSinceChange++;
+		lastResidual = computeResidual(levels[0]) / rhsNorm;
+		solved = true;
+	}
+	if (!changed && !solved) return false;
+	measure();
+	solution++;
+	return true;
+}
+
+void PoissonGrid::allocate(const ImVec2& size) {
+	// Fine grid is coarsest grid refined by 2, so every level matches
+	int refine = std::max(cells / coarsestCells, 1);
+	float longer = std::max(std::max(size.x, size.y), 1e-6f);
+	float h = longer / (coarsestCells * refine);
+	int cx = std::ceil(size.x / h / refine), cy = std::ceil(size.y / h / refine);
+	cx = std::max(cx, 1);
+	cy = std::max(cy, 1);
+
+	levels.clear();
+	for (int r = refine; r >= 1; r /= 2) {
+		Level l;
+		l.nx = cx * r + 1;
+		l.ny = cy * r + 1;
+		l.h = h * refine / r;
+		l.v.assign(l.nx * l.ny, 0.0f);
+		l.f.assign(l.nx * l.ny, 0.0f);
+		l.r.assign(l.nx * l.ny, 0.0f);
+		l.fixed.assign(l.nx * l.ny, 0);
+		levels.push_back(l);
+	}
+}
+
+void PoissonGrid::setSources(const Scene& scene,
+							 const std::vector<Conductor>& conductors) {
+	Level& l = levels[0];
+	std::fill(l.f.begin(), l.f.end(), 0.0f);
+
+	// -laplace(V) = rho / e0 = 4 pi k rho, charge spread over nearest nodes
+	float factor = 4 * M_PI * scene.k / (l.h * l.h);
+	std::vector<PointCharge> charges = scene.discretize(l.h / 2);
+	charges.insert(charges.end(), scene.points.begin(), scene.points.end());
+	for (auto& p : charges) {
+		float gx = p.position.x / l.h, gy = p.position.y / l.h;
+		int i = std::floor(gx), j = std::floor(gy);
+		float tx = gx - i, ty = gy - j;
+		for (int c = 0; c < 4; c++) {
+			int x = i + c % 2, y = j + c / 2;
+			if (x < 0 || y < 0 || x >= l.nx || y >= l.ny) continue;
+			float w = (c % 2 ? tx : 1 - tx) * (c / 2 ? ty : 1 - ty);
+			l.f[y * l.nx + x] += factor * p.charge * w;
+		}
+	}
+
+	// Grounded box and conductors, thin plates cover at least one node
+	for (int y = 0; y < l.ny; y++) {
+		for (int x = 0; x < l.nx; x++) {
+			int n = y * l.nx + x;
+			bool border = x == 0 || y == 0 || x == l.nx - 1 || y == l.ny - 1;
+			l.fixed[n] = border;
+			if (border) l.v[n] = 0.0f;
+			ImVec2 pos(x * l.h, y * l.h);
+			for (auto& c : conductors) {
+				if (pos.x >= std::min(c.min.x, c.max.x) - l.h / 2 &&
+					pos.x <= std::max(c.min.x, c.max.x) + l.h / 2 &&
+					pos.y >= std::min(c.min.y, c.max.y) - l.h / 2 &&
+					pos.y <= std::max(c.min.y, c.max.y) + l.h / 2) {
+					l.fixed[n] = 1;
+					l.v[n] = c.potential;
+				}
+			}
+		}
+	}
+
+	// Coarse levels solve for correction, which is 0 on Dirichlet nodes.
+	// Coarse node is fixed when any fine node it covers is, otherwise thin
+	// plates vanish from coarse levels and cycle diverges.
+	for (size_t i = 1; i < levels.size(); i++) {
+		Level &c = levels[i], &f = levels[i - 1];
+		for (int y = 0; y < c.ny; y++) {
+			for (int x = 0; x < c.nx; x++) {
+				uint8_t fixed = 0;
+				for (int fy = std::max(2 * y - 1, 0);
+					 fy <= std::min(2 * y + 1, f.ny - 1); fy++)
+					for (int fx = std::max(2 * x - 1, 0);
+						 fx <= std::min(2 * x + 1, f.nx - 1); fx++)
+						fixed |= f.fixed[fy * f.nx + fx];
+				c.fixed[y * c.nx + x] = fixed;
+			}
+		}
+	}
+
+	// Residual is measured relative to sources or to potential of plates
+	rhsNorm = 0;
+	for (auto& v : l.f) rhsNorm = std::max(rhsNorm, std::fabs(v));
+	for (auto& c : conductors)
+		rhsNorm = std::max(rhsNorm, std::fabs(c.potential) / (l.h * l.h));
+	if (rhsNorm == 0) rhsNorm = 1;
+}
+
+// Red-black Gauss-Seidel
+void PoissonGrid::smooth(Level& l, int sweeps) {
+	float h2 = l.h * l.h;
+	for (int s = 0; s < sweeps; s++) {
+		for (int color = 0; color < 2; color++) {
+			for (int y = 1; y < l.ny - 1; y++) {
+				int row = y * l.nx;
+				for (int x = 1 + (y + color) % 2; x < l.nx - 1; x += 2) {
+					int n = row + x;
+					if (l.fixed[n]) continue;
+					l.v[n] = 0.25f * (l.v[n - 1] + l.v[n + 1] + l.v[n - l.nx] +
+									  l.v[n + l.nx] + h2 * l.f[n]);
+				}
+			}
+		}
+	}
+}
+
+float PoissonGrid::computeResidual(Level& l) {
+	float inv = 1 / (l.h * l.h), norm = 0;
+	std::fill(l.r.begin(), l.r.end(), 0.0f);
+	for (int y = 1; y < l.ny - 1; y++) {
+		for (int x = 1; x < l.nx - 1; x++) {
+			int n = y * l.nx + x;
+			if (l.fixed[n]) continue;
+			l.r[n] = l.f[n] - (4 * l.v[n] - l.v[n - 1] - l.v[n + 1] -
+							   l.v[n - l.nx] - l.v[n + l.nx]) *
+								  inv;
+			norm = std::max(norm, std::fabs(l.r[n]));
+		}
+	}
+	return norm;
+}
+
+// Full weighting
+void PoissonGrid::restrictResidual(const Level& fine, Level& coarse) {
+	std::fill(coarse.f.begin(), coarse.f.end(), 0.0f);
+	for (int y = 1; y < coarse.ny - 1; y++) {
+		for (int x = 1; x < coarse.nx - 1; x++) {
+			int c = y * coarse.nx + x;
+			if (coarse.fixed[c]) continue;
+			int n = 2 * y * fine.nx + 2 * x, w = fine.nx;
+			const std::vector<float>& r = fine.r;
+			coarse.f[c] = (4 * r[n] + 2 * (r[n - 1] + r[n + 1] + r[n - w] +
+										   r[n + w]) +
+						   r[n - w - 1] + r[n - w + 1] + r[n + w - 1] +
+						   r[n + w + 1]) /
+						  16;
+		}
+	}
+}
+
+// Bilinear interpolation of coarse correction
+void PoissonGrid::prolongCorrection(const Level& coarse, Level& fine) {
+	for (int y = 0; y < fine.ny; y++) {
+		for (int x = 0; x < fine.nx; x++) {
+			int n = y * fine.nx + x;
+			if (fine.fixed[n]) continue;
+			int cx = x / 2, cy = y / 2;
+			int cx2 = std::min(cx + x % 2, coarse.nx - 1),
+				cy2 = std::min(cy + y % 2, coarse.ny - 1);
+			const std::vector<float>& v = coarse.v;
+			fine.v[n] += 0.25f * (v[cy * coarse.nx + cx] +
+								  v[cy * coarse.nx + cx2] +
+								  v[cy2 * coarse.nx + cx] +
+								  v[cy2 * coarse.nx + cx2]);
+		}
+	}
+}
+
+void PoissonGrid::cycle(size_t level) {
+	Level& l = levels[level];
+	if (level + 1 == levels.size()) {
+		smooth(l, 64);
+		return;
+	}
+	smooth(l, 3);
+	computeResidual(l);
+	Level& coarse = levels[level + 1];
+	restrictResidual(l, coarse);
+	std::fill(coarse.v.begin(), coarse.v.end(), 0.0f);
+	cycle(level + 1);
+	prolongCorrection(coarse, l);
+	smooth(l, 3);
+}
+
+void PoissonGrid::measure() {
+	const Level& l = levels[0];
+	fieldMax = potentialMax = 0;
+	for (int y = 0; y + 1 < l.ny; y++) {
+		for (int x = 0; x + 1 < l.nx; x++) {
+			int n = y * l.nx + x;
+			float ex = (l.v[n + 1] - l.v[n]) / l.h,
+				  ey = (l.v[n + l.nx] - l.v[n]) / l.h;
+			fieldMax = std::max(fieldMax, std::sqrt(ex * ex + ey * ey));
+			potentialMax = std::max(potentialMax, std::fabs(l.v[n]));
+		}
+	}
+}
+
+float PoissonGrid::potentialAt(const ImVec2& location) const {
+	if (levels.empty()) return 0.0f;
+	const Level& l = levels[0];
+	float gx = std::min(std::max(location.x / l.h, 0.0f), l.nx - 1.001f),
+		  gy = std::min(std::max(location.y / l.h, 0.0f), l.ny - 1.001f);
+	int i = gx, j = gy, n = j * l.nx + i;
+	float tx = gx - i, ty = gy - j;
+	return (1 - ty) * ((1 - tx) * l.v[n] + tx * l.v[n + 1]) +
+		   ty * ((1 - tx) * l.v[n + l.nx] + tx * l.v[n + l.nx + 1]);
+}
+
+// Gradient of bilinear potential inside cell
+ImVec2 PoissonGrid::fieldAt(const ImVec2& location) const {
+	if (levels.empty()) return ImVec2(0, 0);
+	const Level& l = levels[0];
+	float gx = std::min(std::max(location.x / l.h, 0.0f), l.nx - 1.001f),
+		  gy = std::min(std::max(location.y / l.h, 0.0f), l.ny - 1.001f);
+	int i = gx, j = gy, n = j * l.nx + i;
+	float tx = gx - i, ty = gy - j;
+	float v00 = l.v[n], v10 = l.v[n + 1], v01 = l.v[n + l.nx],
+		  v11 = l.v[n + l.nx + 1];
+	return ImVec2(-((1 - ty) * (v10 - v00) + ty * (v11 - v01)) / l.h,
+				  -((1 - tx) * (v01 - v00) + tx * (v11 - v10)) / l.h);
+}
@@ -0,0 +1,72 @@
+#ifndef ELECTRIC_FIELD_POISSON_H
+#define ELECTRIC_FIELD_POISSON_H
+
+#include <imgui.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "electric_field_scene.hpp"
+
+namespace Electric {
+struct Conductor {
+	ImVec2 min, max;		  // Rectangle in meters
+	float potential = 0.0f;	  // In volts, 0 = grounded
+	bool operator==(const Conductor& c) const {
+		return min.x == c.min.x && min.y == c.min.y && max.x == c.max.x &&
+			   max.y == c.max.y && potential == c.potential;
+	}
+};
+
+// Potential on node grid covering the view, solved with geometric multigrid.
+// View is closed in grounded box. As usual in 2D electrostatics charges are
+// treated as lines with given charge per meter of depth.
+class PoissonGrid {
+   public:
+	int cells = 256;		   // Cells along longer side of view
+	float tolerance = 1e-4f;   // Residual relative to right hand side
+	int cyclesPerUpdate = 4;   // Limit of V-cycles in one update
+
+	// Solution from previous update is used as starting point. Returns
+	// true when potential changed.
+	bool update(const Scene& scene, const std::vector<Conductor>& conductors,
+				const ImVec2& size);
+	ImVec2 fieldAt(const ImVec2& location) const;
+	float potentialAt(const ImVec2& location) const;
+	float residual() const { return lastResidual; }
+	int cycles() const { return cyclesSinceChange; }
+	float maxField() const { return fieldMax; }
+	float maxPotential() const { return potentialMax; }
+	unsigned long version() const { return solution; }
+
+   private:
+	struct Level {
+		int nx = 0, ny = 0;
+		float h = 0;
+		std::vector<float> v, f, r;	 // Potential, right hand side, residual
+		std::vector<uint8_t> fixed;	 // Dirichlet nodes
+	};
+	std::vector<Level> levels;
+	Scene lastSources;
+	std::vector<Conductor> lastConductors;
+	ImVec2 lastSize = {0, 0};
+	int lastCells = 0;
+	float lastK = 0;
+	float lastResidual = 0, rhsNorm = 1;
+	float fieldMax = 0, potentialMax = 0;
+	int cyclesSinceChange = 0;
+	unsigned long solution = 0;
+
+	void allocate(const ImVec2& size);
+	void setSources(const Scene& scene,
+					const std::vector<Conductor>& conductors);
+	void smooth(Level& l, int sweeps);
+	float computeResidual(Level& l);
+	void restrictResidual(const Level& fine, Level& coarse);
+	void prolongCorrection(const Level& coarse, Level& fine);
+	void cycle(size_t level);
+	void measure();
+};
+}  // namespace Electric
+
+#endif
@@ -0,0 +1,359 @@
+#include "electric_field_scene.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "../basic.hpp"
+#include "electric_field_poisson.hpp"
+#include "electric_field_tree.hpp"
+
+using namespace Electric;
+
+namespace {
+// Distance between point and rectangle <min, max>, 0 when inside.
+float distanceToRect(const ImVec2& p, const ImVec2& min, const ImVec2& max) {
+	float dx = std::max(std::max(min.x - p.x, p.x - max.x), 0.0f);
+	float dy = std::max(std::max(min.y - p.y, p.y - max.y), 0.0f);
+	return std::sqrt(dx * dx + dy * dy);
+}
+
+float distanceBetweenRects(const ImVec2& aMin, const ImVec2& aMax,
+						   const ImVec2& bMin, const ImVec2& bMax) {
+	float dx = std::max(std::max(aMin.x - bMax.x, bMin.x - aMax.x), 0.0f);
+	float dy = std::max(std::max(aMin.y - bMax.y, bMin.y - aMax.y), 0.0f);
+	return std::sqrt(dx * dx + dy * dy);
+}
+
+// Segment in coordinates of sample point: s along segment from a to b and
+// signed distance d from its line. Field per unit of k * density.
+void addLineField(const LineCharge& l, const ImVec2& p, float minDistance,
+				  double& x, double& y) {
+	double tx = l.b.x - l.a.x, ty = l.b.y - l.a.y;
+	double length = std::sqrt(tx * tx + ty * ty);
+	if (length == 0) return;
+	tx /= length;
+	ty /= length;
+	double sa = (l.a.x - p.x) * tx + (l.a.y - p.y) * ty, sb = sa + length;
+	double d = (l.a.x - p.x) * ty - (l.a.y - p.y) * tx;
+	if (std::fabs(d) < minDistance) d = std::copysign(minDistance, d);
+	double ra = std::sqrt(sa * sa + d * d), rb = std::sqrt(sb * sb + d * d);
+	double along = 1 / rb - 1 / ra, across = (sb / rb - sa / ra) / d;
+	x += l.density * (along * tx - across * ty);
+	y += l.density * (along * ty + across * tx);
+}
+
+double linePotential(const LineCharge& l, const ImVec2& p, float minDistance) {
+	double tx = l.b.x - l.a.x, ty = l.b.y - l.a.y;
+	double length = std::sqrt(tx * tx + ty * ty);
+	if (length == 0) return 0;
+	tx /= length;
+	ty /= length;
+	double sa = (l.a.x - p.x) * tx + (l.a.y - p.y) * ty, sb = sa + length;
+	double d = (l.a.x - p.x) * ty - (l.a.y - p.y) * tx;
+	d = std::max(std::fabs(d), (double)minDistance);
+	double ra = std::sqrt(sa * sa + d * d), rb = std::sqrt(sb * sb + d * d);
+	// ln((sb + rb) / (sa + ra)), written so no sum cancels
+	double v;
+	if (sa >= 0) {
+		v = std::log((sb + rb) / (sa + ra));
+	} else if (sb <= 0) {
+		v = std::log((ra - sa) / (rb - sb));
+	} else {
+		v = std::log((sb + rb) * (ra - sa) / (d * d));
+	}
+	return l.density * v;
+}
+
+// ln(y + sqrt(x^2 + y^2)), for negative y as ln(x^2) - ln(r - y)
+double logTerm(double x, double y, double minSq) {
+	double r = std::sqrt(x * x + y * y);
+	if (y > 0) return std::log(y + r);
+	return std::log(std::max(x * x, minSq)) - std::log(std::max(r - y, 1e-30));
+}
+
+// Sheet corners relative to sample point. In plane of sheet
+// Ex = sum(+-ln(y + r)), Ey = sum(+-ln(x + r)) and
+// V = sum(+-(x ln(y + r) + y ln(x + r))) over its corners.
+void addSheetField(const SheetCharge& s, const ImVec2& p, float minDistance,
+				   double& x, double& y) {
+	double x1 = std::min(s.min.x, s.max.x) - p.x,
+		   x2 = std::max(s.min.x, s.max.x) - p.x,
+		   y1 = std::min(s.min.y, s.max.y) - p.y,
+		   y2 = std::max(s.min.y, s.max.y) - p.y;
+	double minSq = (double)minDistance * minDistance;
+	x += s.density * (logTerm(x2, y2, minSq) - logTerm(x2, y1, minSq) -
+					  logTerm(x1, y2, minSq) + logTerm(x1, y1, minSq));
+	y += s.density * (logTerm(y2, x2, minSq) - logTerm(y1, x2, minSq) -
+					  logTerm(y2, x1, minSq) + logTerm(y1, x1, minSq));
+}
+
+double sheetPotential(const SheetCharge& s, const ImVec2& p,
+					  float minDistance) {
+	double x1 = std::min(s.min.x, s.max.x) - p.x,
+		   x2 = std::max(s.min.x, s.max.x) - p.x,
+		   y1 = std::min(s.min.y, s.max.y) - p.y,
+		   y2 = std::max(s.min.y, s.max.y) - p.y;
+	double minSq = (double)minDistance * minDistance;
+	auto corner = [&](double x, double y) {
+		return x * logTerm(x, y, minSq) + y * logTerm(y, x, minSq);
+	};
+	return s.density *
+		   (corner(x2, y2) - corner(x2, y1) - corner(x1, y2) + corner(x1, y1));
+}
+
+// Bounding box, total charge and translation against previous state, used
+// to bound change of field
+void sourceInfo(const LineCharge& l, ImVec2& min, ImVec2& max, float& charge) {
+	min = ImVec2(std::min(l.a.x, l.b.x), std::min(l.a.y, l.b.y));
+	max = ImVec2(std::max(l.a.x, l.b.x), std::max(l.a.y, l.b.y));
+	charge = l.density * distanceBetweenPoints(l.a, l.b);
+}
+void sourceInfo(const ArcCharge& a, ImVec2& min, ImVec2& max, float& charge) {
+	min = ImVec2(a.center.x - a.radius, a.center.y - a.radius);
+	max = ImVec2(a.center.x + a.radius, a.center.y + a.radius);
+	charge = a.density * a.radius * std::fabs(a.end - a.start);
+}
+void sourceInfo(const SheetCharge& s, ImVec2& min, ImVec2& max,
+				float& charge) {
+	min = ImVec2(std::min(s.min.x, s.max.x), std::min(s.min.y, s.max.y));
+	max = ImVec2(std::max(s.min.x, s.max.x), std::max(s.min.y, s.max.y));
+	charge = s.density * (max.x - min.x) * (max.y - min.y);
+}
+bool translation(const LineCharge& now, const LineCharge& then) {
+	return now.density == then.density &&
+		   now.b.x - now.a.x == then.b.x - then.a.x &&
+		   now.b.y - now.a.y == then.b.y - then.a.y;
+}
+bool translation(const ArcCharge& now, const ArcCharge& then) {
+	return now.density == then.density && now.radius == then.radius &&
+		   now.start == then.start && now.end == then.end;
+}
+bool translation(const SheetCharge& now, const SheetCharge& then) {
+	return now.density == then.density &&
+		   now.max.x - now.min.x == then.max.x - then.min.x &&
+		   now.max.y - now.min.y == then.max.y - then.min.y;
+}
+
+// Calls add(charge, distance) for sources which appeared, vanished or
+// changed shape and shift(charge, length, distance) for moved ones
+template <class Source, class Add, class Shift>
+void compareSources(const std::vector<Source>& now,
+					const std::vector<Source>& then, const ImVec2& min,
+					const ImVec2& max, Add add, Shift shift) {
+	size_t count = std::max(now.size(), then.size());
+	ImVec2 nowMin, nowMax, thenMin, thenMax;
+	float nowCharge, thenCharge;
+	for (size_t i = 0; i < count; i++) {
+		bool isNow = i < now.size(), wasThen = i < then.size();
+		if (isNow) sourceInfo(now[i], nowMin, nowMax, nowCharge);
+		if (wasThen) sourceInfo(then[i], thenMin, thenMax, thenCharge);
+		if (isNow && wasThen) {
+			if (now[i] == then[i]) continue;
+			if (translation(now[i], then[i])) {
+				float length = distanceBetweenPoints(nowMin, thenMin);
+				ImVec2 sweptMin(std::min(nowMin.x, thenMin.x),
+								std::min(nowMin.y, thenMin.y)),
+					sweptMax(std::max(nowMax.x, thenMax.x),
+							 std::max(nowMax.y, thenMax.y));
+				shift(nowCharge, length,
+					  distanceBetweenRects(min, max, sweptMin, sweptMax));
+				continue;
+			}
+		}
+		if (isNow)
+			add(nowCharge, distanceBetweenRects(min, max, nowMin, nowMax));
+		if (wasThen)
+			add(thenCharge, distanceBetweenRects(min, max, thenMin, thenMax));
+	}
+}
+}  // namespace
+
+void Scene::setPoints(const std::vector<object>& objects) {
+	bool changed = points.size() != objects.size();
+	points.resize(objects.size());
+	for (size_t i = 0; i < objects.size(); i++) {
+		PointCharge p;
+		p.position = objects[i].position;
+		p.charge = objects[i].charge;
+		if (p != points[i]) {
+			points[i] = p;
+			changed = true;
+		}
+	}
+	updateTree(changed);
+}
+
+void Scene::setPoints(const std::vector<PointCharge>& charges) {
+	bool changed = charges != points;
+	if (changed) points = charges;
+	updateTree(changed);
+}
+
+// Arc has no elementary field, it is replaced by chords carrying its charge
+void Scene::setArcs(const std::vector<ArcCharge>& arcs) {
+	if (arcs == this->arcs) return;
+	this->arcs = arcs;
+	chords.clear();
+	for (auto& a : arcs) {
+		float sweep = a.end - a.start;
+		int count = std::max((int)std::ceil(std::fabs(sweep) / (M_PI / 8)), 1);
+		float step = sweep / count;
+		float chord = 2 * a.radius * std::sin(std::fabs(step) / 2);
+		float density =
+			chord > 0 ? a.density * a.radius * std::fabs(step) / chord : 0;
+		for (int i = 0; i < count; i++) {
+			float from = a.start + i * step, to = from + step;
+			chords.push_back(
+				LineCharge{{a.center.x + a.radius * std::cos(from),
+							a.center.y + a.radius * std::sin(from)},
+						   {a.center.x + a.radius * std::cos(to),
+							a.center.y + a.radius * std::sin(to)},
+						   density});
+		}
+	}
+}
+
+std::vector<PointCharge> Scene::discretize(float spacing) const {
+	std::vector<PointCharge> result;
+	auto addLine = [&](const LineCharge& l) {
+		float length = distanceBetweenPoints(l.a, l.b);
+		int count = std::max((int)std::ceil(length / spacing), 1);
+		for (int i = 0; i < count; i++) {
+			float t = (i + 0.5f) / count;
+			result.push_back(PointCharge{{l.a.x + (l.b.x - l.a.x) * t,
+										  l.a.y + (l.b.y - l.a.y) * t},
+										 l.density * length / count});
+		}
+	};
+	for (auto& l : lines) addLine(l);
+	for (auto& l : chords) addLine(l);
+	for (auto& s : sheets) {
+		ImVec2 min, max;
+		float charge;
+		sourceInfo(s, min, max, charge);
+		int nx = std::max((int)std::ceil((max.x - min.x) / spacing), 1),
+			ny = std::max((int)std::ceil((max.y - min.y) / spacing), 1);
+		for (int y = 0; y < ny; y++)
+			for (int x = 0; x < nx; x++)
+				result.push_back(PointCharge{
+					{min.x + (max.x - min.x) * (x + 0.5f) / nx,
+					 min.y + (max.y - min.y) * (y + 0.5f) / ny},
+					charge / (nx * ny)});
+	}
+	return result;
+}
+
+bool Scene::sameSources(const Scene& s) const {
+	return points == s.points && lines == s.lines && arcs == s.arcs &&
+		   sheets == s.sheets;
+}
+
+void Scene::updateTree(bool pointsChanged) {
+	if (accuracy <= 0 || points.size() < treeThreshold) {
+		tree.reset();
+	} else if (pointsChanged || tree == NULL) {
+		tree = std::make_shared<const ChargeTree>(points);
+	}
+}
+
+void Scene::setGrid(const PoissonGrid* grid) {
+	this->grid = grid;
+	gridVersion = grid != NULL ? grid->version() : 0;
+}
+
+ImVec2 Scene::fieldAt(const ImVec2& location) const {
+	if (grid != NULL) return grid->fieldAt(location);
+	double x = 0, y = 0;
+	for (auto& l : lines) addLineField(l, location, minDistance, x, y);
+	for (auto& l : chords) addLineField(l, location, minDistance, x, y);
+	for (auto& s : sheets) addSheetField(s, location, minDistance, x, y);
+	x *= k;
+	y *= k;
+	if (tree != NULL) {
+		ImVec2 e = tree->fieldAt(location, accuracy, k, minDistance);
+		return ImVec2(x + e.x, y + e.y);
+	}
+	float minSq = minDistance * minDistance;
+	for (auto& p : points) {
+		float dx = location.x - p.position.x, dy = location.y - p.position.y;
+		float rSq = std::max(dx * dx + dy * dy, minSq);
+		float power = k * p.charge / (rSq * std::sqrt(rSq));
+		x += power * dx;
+		y += power * dy;
+	}
+	return ImVec2(x, y);
+}
+
+float Scene::potentialAt(const ImVec2& location) const {
+	if (grid != NULL) return grid->potentialAt(location);
+	double v = 0;
+	for (auto& l : lines) v += linePotential(l, location, minDistance);
+	for (auto& l : chords) v += linePotential(l, location, minDistance);
+	for (auto& s : sheets) v += sheetPotential(s, location, minDistance);
+	v *= k;
+	if (tree != NULL)
+		return v + tree->potentialAt(location, accuracy, k, minDistance);
+	for (auto& p : points) {
+		float r = std::max(distanceBetweenPoints(location, p.position),
+						   minDistance);
+		v += k * p.charge / r;
+	}
+	return v;
+}
+
+float Scene::changeBound(const Scene& before, const ImVec2& min,
+						 const ImVec2& max, bool potential) const {
+	if (k != before.k || minDistance != before.minDistance ||
+		accuracy != before.accuracy || grid != NULL || before.grid != NULL)
+		return std::numeric_limits<float>::infinity();
+	double bound = 0;
+	// |E| of point charge falls as 1/r^2 and its gradient as 2/r^3
+	auto add = [&](float charge, float r) {
+		r = std::max(r, minDistance);
+		bound += k * std::fabs(charge) / (potential ? r : r * r);
+	};
+	auto addMove = [&](float charge, const ImVec2& from, const ImVec2& to) {
+		float length = distanceBetweenPoints(from, to);
+		ImVec2 middle((from.x + to.x) / 2, (from.y + to.y) / 2);
+		float r = std::max(distanceToRect(middle, min, max) - length / 2,
+						   minDistance);
+		bound += k * std::fabs(charge) * length *
+				 (potential ? 1 / (r * r) : 2 / (r * r * r));
+	};
+	// Every part of distributed source is at least r away
+	auto shift = [&](float charge, float length, float r) {
+		r = std::max(r, minDistance);
+		bound += k * std::fabs(charge) * length *
+				 (potential ? 1 / (r * r) : 2 / (r * r * r));
+	};
+	compareSources(lines, before.lines, min, max, add, shift);
+	compareSources(arcs, before.arcs, min, max, add, shift);
+	compareSources(sheets, before.sheets, min, max, add, shift);
+
+	size_t count = std::max(points.size(), before.points.size());
+	for (size_t i = 0; i < count; i++) {
+		bool now = i < points.size(), then = i < before.points.size();
+		if (now && then) {
+			const PointCharge &p = points[i], &b = before.points[i];
+			if (p == b) continue;
+			addMove(b.charge, b.position, p.position);
+			add(p.charge - b.charge, distanceToRect(p.position, min, max));
+		} else if (now) {
+			add(points[i].charge, distanceToRect(points[i].position, min, max));
+		} else {
+			add(before.points[i].charge,
+				distanceToRect(before.points[i].position, min, max));
+		}
+	}
+	return bound;
+}
+
+bool Scene::operator==(const Scene& s) const {
+	return k == s.k && minDistance == s.minDistance &&
+		   accuracy == s.accuracy && grid == s.grid &&
+		   gridVersion == s.gridVersion && sameSources(s);
+}
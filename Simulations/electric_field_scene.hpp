@@ -0,0 +1,103 @@
+#ifndef ELECTRIC_FIELD_SCENE_H
+#define ELECTRIC_FIELD_SCENE_H
+
+#include <imgui.h>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "../basic.hpp"
+
+namespace Electric {
+struct PointCharge {
+	ImVec2 position = {0, 0};  // In meters
+	float charge = 0.0f;	   // In Columbs
+	bool operator==(const PointCharge& c) const {
+		return position.x == c.position.x && position.y == c.position.y &&
+			   charge == c.charge;
+	}
+	bool operator!=(const PointCharge& c) const { return !(*this == c); }
+};
+
+// Uniformly charged segment <a, b>
+struct LineCharge {
+	ImVec2 a = {0, 0}, b = {0, 0};	// In meters
+	float density = 0.0f;			// In Columbs per meter
+	bool operator==(const LineCharge& l) const {
+		return a.x == l.a.x && a.y == l.a.y && b.x == l.b.x && b.y == l.b.y &&
+			   density == l.density;
+	}
+	bool operator!=(const LineCharge& l) const { return !(*this == l); }
+};
+
+// Uniformly charged arc of circle, from angle start to end in radians
+struct ArcCharge {
+	ImVec2 center = {0, 0};	 // In meters
+	float radius = 0.1f;	 // In meters
+	float start = 0.0f, end = M_PI;
+	float density = 0.0f;  // In Columbs per meter
+	bool operator==(const ArcCharge& a) const {
+		return center.x == a.center.x && center.y == a.center.y &&
+			   radius == a.radius && start == a.start && end == a.end &&
+			   density == a.density;
+	}
+	bool operator!=(const ArcCharge& a) const { return !(*this == a); }
+};
+
+// Uniformly charged rectangle <min, max>
+struct SheetCharge {
+	ImVec2 min = {0, 0}, max = {0, 0};	// In meters
+	float density = 0.0f;				// In Columbs per square meter
+	bool operator==(const SheetCharge& s) const {
+		return min.x == s.min.x && min.y == s.min.y && max.x == s.max.x &&
+			   max.y == s.max.y && density == s.density;
+	}
+	bool operator!=(const SheetCharge& s) const { return !(*this == s); }
+};
+
+class ChargeTree;
+class PoissonGrid;
+
+// Snapshot of all field sources. Every field renderer reads from it, so
+// it can compare two snapshots and update only what changed.
+class Scene {
+   public:
+	float k = 8.99e9f;
+	float minDistance = 1e-4f;	// Closer samples are clamped, in meters
+	float accuracy = 0.5f;	// Opening angle of multipole tree, 0 = exact sums
+	// Largest accuracy, past it error of expansion grows quickly
+	static constexpr float maxAccuracy = 0.7f;
+	std::vector<PointCharge> points;
+	std::vector<LineCharge> lines;
+	std::vector<ArcCharge> arcs;  // Set with setArcs
+	std::vector<SheetCharge> sheets;
+
+	void setPoints(const std::vector<object>& objects);
+	void setPoints(const std::vector<PointCharge>& charges);
+	void setArcs(const std::vector<ArcCharge>& arcs);
+	// Point charges with given spacing in place of lines, arcs and sheets
+	std::vector<PointCharge> discretize(float spacing) const;
+	bool sameSources(const Scene& s) const;
+	// With grid, field comes from its solution instead of sum over charges
+	void setGrid(const PoissonGrid* grid);
+	ImVec2 fieldAt(const ImVec2& location) const;	  // In N/C
+	float potentialAt(const ImVec2& location) const;  // In V
+	// Upper bound of change of |E| (or |V|) inside rectangle <min, max>
+	// between previous snapshot and this one.
+	float changeBound(const Scene& before, const ImVec2& min,
+					  const ImVec2& max, bool potential) const;
+	bool operator==(const Scene& s) const;
+	bool operator!=(const Scene& s) const { return !(*this == s); }
+
+   private:
+	static const size_t treeThreshold = 64;	 // Fewer charges are summed
+	std::vector<LineCharge> chords;	// Arcs split to segments
+	std::shared_ptr<const ChargeTree> tree;	 // Shared between copies
+	const PoissonGrid* grid = NULL;
+	unsigned long gridVersion = 0;	// Version of grid solution
+	void updateTree(bool pointsChanged);
+};
+}  // namespace Electric
+
+#endif
@@ -0,0 +1,154 @@
+#include "electric_field_tree.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace Electric;
+
+ChargeTree::ChargeTree(const std::vector<PointCharge>& points) {
+	rebuild(points);
+}
+
+void ChargeTree::rebuild(const std::vector<PointCharge>& points) {
+	this->points.assign(points.begin(), points.end());
+	nodes.clear();
+	if (points.empty()) return;
+	ImVec2 min = points[0].position, max = points[0].position;
+	for (auto& p : points) {
+		min = ImVec2(std::min(min.x, p.position.x),
+					 std::min(min.y, p.position.y));
+		max = ImVec2(std::max(max.x, p.position.x),
+					 std::max(max.y, p.position.y));
+	}
+	float size = std::max(std::max(max.x - min.x, max.y - min.y), 1e-6f);
+	nodes.reserve(2 * points.size() / leafSize + 1);
+	build(0, points.size(),
+		  ImVec2((min.x + max.x) / 2, (min.y + max.y) / 2), size * 1.001f, 0);
+}
+
+int ChargeTree::build(int first, int count, const ImVec2& center, float size,
+					  int depth) {
+	int id = nodes.size();
+	nodes.push_back(Node());
+	Node node;
+	node.center = center;
+	node.size = size;
+	node.first = first;
+	node.count = count;
+	for (int i = first; i < first + count; i++) {
+		const PointCharge& p = points[i];
+		float dx = p.position.x - center.x, dy = p.position.y - center.y;
+		node.charge += p.charge;
+		node.dipole.x += p.charge * dx;
+		node.dipole.y += p.charge * dy;
+		node.qxx += p.charge * (2 * dx * dx - dy * dy);
+		node.qyy += p.charge * (2 * dy * dy - dx * dx);
+		node.qxy += p.charge * 3 * dx * dy;
+	}
+
+	// Coincident charges can't be split, so depth is limited
+	if (count > leafSize && depth < 32) {
+		auto begin = points.begin() + first, end = begin + count;
+		auto midY = std::partition(begin, end, [&](const PointCharge& p) {
+			return p.position.y < center.y;
+		});
+		auto lowerX = std::partition(begin, midY, [&](const PointCharge& p) {
+			return p.position.x < center.x;
+		});
+		auto upperX = std::partition(midY, end, [&](const PointCharge& p) {
+			return p.position.x < center.x;
+		});
+		decltype(begin) bounds[5] = {begin, lowerX, midY, upperX, end};
+		float q = size / 4;
+		for (int c = 0; c < 4; c++) {
+			int n = bounds[c + 1] - bounds[c];
+			if (n == 0) continue;
+			ImVec2 childCenter(center.x + (c % 2 ? q : -q),
+							   center.y + (c / 2 ? q : -q));
+			node.children[c] = build(bounds[c] - points.begin(), n,
+									 childCenter, size / 2, depth + 1);
+		}
+	}
+	nodes[id] = node;
+	return id;
+}
+
+bool ChargeTree::approximated(const Node& n, float rx, float ry,
+							  float accuracy) {
+	float half = n.size / 2;
+	if (std::fabs(rx) <= half && std::fabs(ry) <= half) return false;
+	return n.size * n.size < accuracy * accuracy * (rx * rx + ry * ry);
+}
+
+ImVec2 ChargeTree::fieldAt(const ImVec2& location, float accuracy, float k,
+						   float minDistance) const {
+	double x = 0, y = 0;
+	float minSq = minDistance * minDistance;
+	int stack[128], top = 0;
+	if (!nodes.empty()) stack[top++] = 0;
+	while (top > 0) {
+		const Node& n = nodes[stack[--top]];
+		float rx = location.x - n.center.x, ry = location.y - n.center.y;
+		float rSq = rx * rx + ry * ry;
+		if (approximated(n, rx, ry, accuracy)) {
+			float inv = 1 / std::sqrt(rSq), inv2 = inv * inv;
+			float inv3 = inv * inv2, inv5 = inv3 * inv2;
+			float pr = n.dipole.x * rx + n.dipole.y * ry;
+			float qrx = n.qxx * rx + n.qxy * ry, qry = n.qxy * rx + n.qyy * ry;
+			float rqr = rx * qrx + ry * qry;
+			float radial = n.charge * inv3 + 3 * pr * inv5 +
+						   2.5f * rqr * inv5 * inv2;
+			x += k * (radial * rx - n.dipole.x * inv3 - qrx * inv5);
+			y += k * (radial * ry - n.dipole.y * inv3 - qry * inv5);
+		} else if (n.children[0] == -1 && n.children[1] == -1 &&
+				   n.children[2] == -1 && n.children[3] == -1) {
+			for (int i = n.first; i < n.first + n.count; i++) {
+				const PointCharge& p = points[i];
+				float dx = location.x - p.position.x,
+					  dy = location.y - p.position.y;
+				float r2 = std::max(dx * dx + dy * dy, minSq);
+				float power = k * p.charge / (r2 * std::sqrt(r2));
+				x += power * dx;
+				y += power * dy;
+			}
+		} else {
+			for (int c : n.children)
+				if (c != -1) stack[top++] = c;
+		}
+	}
+	return ImVec2(x, y);
+}
+
+float ChargeTree::potentialAt(const ImVec2& location, float accuracy, float k,
+							  float minDistance) const {
+	double v = 0;
+	int stack[128], top = 0;
+	if (!nodes.empty()) stack[top++] = 0;
+	while (top > 0) {
+		const Node& n = nodes[stack[--top]];
+		float rx = location.x - n.center.x, ry = location.y - n.center.y;
+		float rSq = rx * rx + ry * ry;
+		if (approximated(n, rx, ry, accuracy)) {
+			float inv = 1 / std::sqrt(rSq), inv2 = inv * inv;
+			float pr = n.dipole.x * rx + n.dipole.y * ry;
+			float rqr = rx * (n.qxx * rx + n.qxy * ry) +
+						ry * (n.qxy * rx + n.qyy * ry);
+			v += k * inv * (n.charge + pr * inv2 + 0.5f * rqr * inv2 * inv2);
+		} else if (n.children[0] == -1 && n.children[1] == -1 &&
+				   n.children[2] == -1 && n.children[3] == -1) {
+			for (int i = n.first; i < n.first + n.count; i++) {
+				float dx = location.x - points[i].position.x,
+					  dy = location.y - points[i].position.y;
+				float r = std::max(std::sqrt(dx * dx + dy * dy), minDistance);
+				v += k * points[i].charge / r;
+			}
+		} else {
+			for (int c : n.children)
+				if (c != -1) stack[top++] = c;
+		}
+	}
+	return v;
+}
@@ -0,0 +1,48 @@
+#ifndef ELECTRIC_FIELD_TREE_H
+#define ELECTRIC_FIELD_TREE_H
+
+#include <imgui.h>
+
+#include <vector>
+
+#include "electric_field_scene.hpp"
+
+namespace Electric {
+// Quadtree over point charges. Distant cells are replaced by their
+// monopole, dipole and quadrupole moments, so one evaluation costs about
+// log(n) instead of n.
+class ChargeTree {
+   public:
+	ChargeTree() {}
+	ChargeTree(const std::vector<PointCharge>& points);
+	// Builds tree again, memory of previous build is reused
+	void rebuild(const std::vector<PointCharge>& points);
+	// Cells seen under angle smaller than accuracy are approximated
+	ImVec2 fieldAt(const ImVec2& location, float accuracy, float k,
+				   float minDistance) const;
+	float potentialAt(const ImVec2& location, float accuracy, float k,
+					  float minDistance) const;
+
+   private:
+	static const int leafSize = 8;
+	struct Node {
+		ImVec2 center;	// Center of square cell and of expansion
+		float size;		// Side of cell
+		int first, count;	   // Range in points
+		int children[4] = {-1, -1, -1, -1};
+		float charge = 0;	   // Monopole
+		ImVec2 dipole = {0, 0};
+		float qxx = 0, qxy = 0, qyy = 0;  // Traceless quadrupole
+	};
+	std::vector<PointCharge> points;
+	std::vector<Node> nodes;
+
+	int build(int first, int count, const ImVec2& center, float size,
+			  int depth);
+	// Cell holding location is always opened, so charge never sees itself
+	static bool approximated(const Node& n, float rx, float ry,
+							 float accuracy);
+};
+}  // namespace Electric
+
+#endif
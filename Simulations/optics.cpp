@@ -3,14 +3,149 @@
 #include <imgui.h>
 
 #include <algorithm>
-#include <tuple>
+#include <string>
 #include <vector>
 
+#include "../parallel.hpp"
 #include "../translate.hpp"
+#include "optics_irradiance.hpp"
+#include "optics_optimizer.hpp"
+#include "optics_paraxial.hpp"
+#include "optics_trace.hpp"
+#include "optics_wave.hpp"
 
 using namespace std;
 using namespace Optic;
 
+namespace {
+// Wave bench in window of its own, axis goes to the right across it and
+// field width spans its height
+void drawWave(Wave& wave, bool* open) {
+	ImGui::SetNextWindowSize(ImVec2(800, 500), ImGuiCond_FirstUseEver);
+	ImGui::Begin(tr("Wave optics").c_str(), open, ImGuiWindowFlags_MenuBar);
+	if (ImGui::BeginMenuBar()) {
+		if (ImGui::BeginMenu(tr("Options").c_str())) {
+			ImGui::SliderFloat(tr("Wavelength").c_str(), &wave.wavelength,
+							   380.0f, 750.0f, "%.1f nm",
+							   ImGuiSliderFlags_AlwaysClamp);
+			float width = wave.fieldWidth * 1e3f;
+			if (ImGui::DragFloat(tr("Field width").c_str(), &width, 0.05f,
+								 0.1f, 100.0f, "%.2f mm",
+								 ImGuiSliderFlags_Logarithmic |
+									 ImGuiSliderFlags_AlwaysClamp))
+				wave.fieldWidth = width * 1e-3f;
+			ImGui::DragFloat(
+				tr("Length").c_str(), &wave.length, 1e-3f, 1e-3f, 10.0f,
+				"%.3f m",
+				ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_AlwaysClamp);
+			ImGui::SliderFloat(tr("Exposure").c_str(), &wave.exposure, 0.01f,
+							   100.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+			ImGui::SliderInt(tr("Resolution").c_str(), &wave.pixelStep, 1, 8,
+							 "%d px", ImGuiSliderFlags_AlwaysClamp);
+			ImGui::EndMenu();
+		}
+		if (ImGui::BeginMenu(tr("Elements").c_str())) {
+			std::string slits = tr("Slits"), lens = tr("Lens");
+			const char* types[] = {slits.c_str(), lens.c_str()};
+			for (size_t i = 0; i < wave.elements.size(); i++) {
+				WaveElement& e = wave.elements[i];
+				ImGui::PushID(i);
+				int type = e.type;
+				if (ImGui::Combo("##Type", &type, types, IM_ARRAYSIZE(types)))
+					e.type = (WaveElement::Type)type;
+				ImGui::DragFloat(tr("Position").c_str(), &e.position, 1e-3f,
+								 0.0f, wave.length, "%.3f m",
+								 ImGuiSliderFlags_AlwaysClamp);
+				if (e.type == WaveElement::Type::slits) {
+					// Slits are micrometers wide
+					float width = e.width * 1e6f,
+						  separation = e.separation * 1e6f;
+					ImGui::DragInt(tr("Count").c_str(), &e.count, 0.1f, 1, 100,
+								   "%d", ImGuiSliderFlags_AlwaysClamp);
+					if (ImGui::DragFloat(tr("Width").c_str(), &width, 1.0f,
+										 1.0f, 10000.0f, "%.0f um",
+										 ImGuiSliderFlags_Logarithmic |
+											 ImGuiSliderFlags_AlwaysClamp))
+						e.width = width * 1e-6f;
+					if (ImGui::DragFloat(tr("Separation").c_str(), &separation,
+										 1.0f, 1.0f, 10000.0f, "%.0f um",
+										 ImGuiSliderFlags_Logarithmic |
+											 ImGuiSliderFlags_AlwaysClamp))
+						e.separation = separation * 1e-6f;
+				} else {
+					// Negative focus makes diverging lens
+					ImGui::DragFloat(tr("Principal focus").c_str(), &e.focus,
+									 1e-3f, -10.0f, 10.0f, "%.3f m",
+									 ImGuiSliderFlags_AlwaysClamp);
+					if (e.focus == 0) e.focus = 1e-3f;
+				}
+				if (ImGui::Button(tr("Remove").c_str()))
+					wave.elements.erase(wave.elements.begin() + i);
+				ImGui::Separator();
+				ImGui::PopID();
+			}
+			for (int t = 0; t < IM_ARRAYSIZE(types); t++) {
+				if (t > 0) ImGui::SameLine();
+				ImGui::PushID(t);
+				if (ImGui::Button(
+						(tr("Add") + " " + std::string(types[t])).c_str())) {
+					WaveElement e;
+					e.type = (WaveElement::Type)t;
+					wave.elements.push_back(e);
+				}
+				ImGui::PopID();
+			}
+			ImGui::EndMenu();
+		}
+		ImGui::EndMenuBar();
+	}
+
+	ImVec2 origin = ImGui::GetCursorScreenPos(),
+		   size = ImGui::GetContentRegionAvail();
+	ImDrawList* draw = ImGui::GetWindowDrawList();
+	wave.update(size);
+	wave.draw(draw, origin);
+
+	// Opaque parts of slit screens between slits, lenses as lines
+	auto across = [&](float y) {
+		return origin.y + (y / wave.fieldWidth + 0.5f) * size.y;
+	};
+	for (auto& e : wave.elements) {
+		float x = origin.x + e.position / wave.length * size.x;
+		if (e.type == WaveElement::Type::lens) {
+			draw->AddLine(ImVec2(x, origin.y), ImVec2(x, origin.y + size.y),
+						  ImColor(120, 200, 255, 160), 2.0f);
+			continue;
+		}
+		float top = origin.y;
+		for (int j = 0; j < e.count; j++) {
+			float center = (j - (e.count - 1) / 2.0f) * e.separation;
+			float from = across(center - e.width / 2);
+			if (from > top)
+				draw->AddLine(ImVec2(x, top), ImVec2(x, from),
+							  ImColor(160, 160, 160), 3.0f);
+			top = std::max(top, across(center + e.width / 2));
+		}
+		if (top < origin.y + size.y)
+			draw->AddLine(ImVec2(x, top), ImVec2(x, origin.y + size.y),
+						  ImColor(160, 160, 160), 3.0f);
+	}
+
+	// Intensity at end of bench along right edge
+	const vector<float>& profile = wave.profile();
+	float brightest = 0;
+	for (float v : profile) brightest = std::max(brightest, v);
+	if (brightest > 0) {
+		for (size_t i = 0; i < profile.size(); i++)
+			draw->PathLineTo(
+				ImVec2(origin.x + size.x - profile[i] / brightest * 80.0f,
+					   origin.y + (i + 0.5f) / profile.size() * size.y));
+		draw->PathStroke(ImColor(255, 255, 255, 200), 0, 1.0f);
+	}
+	ImGui::End();
+}
+}  // namespace
+
 Optics::Optics() {
 	this->keepActive = true;
 	this->name = "Optics";
@@ -20,8 +155,21 @@ void Optics::draw() {
 	static float scale = 1000.0f;  // scale px = 1m
 	static vector<Lens> lens;
 	static vector<Ray> rays;
-	static uint8_t raysCount = 4;
-	static float raysGap = 0.05f;
+	static vector<Ray*> retraced;  // Rays traced in this frame
+	static vector<Source> sources = {Source()};
+	static Source* movedSource = NULL;
+	static Tracer tracer;
+	static Irradiance irradiance;
+	static bool showIrradiance = false;
+	static Paraxial paraxial;
+	static vector<Ray> paraxialRays;
+	static bool paraxialMode = false, compareExact = false;
+	static float largestDifference = 0.0f;	// In rad
+	static size_t comparedRays = 0;
+	static int mirrorArrayCount = 100;
+	static Wave wave;
+	static bool showWave = false;
+	static Optimizer optimizer;
 	static bool _onlyOnceExecutedScript = []() {
 		Lens l1;
 		l1.position = {0.3f, 0.325f};
@@ -46,12 +194,24 @@ void Optics::draw() {
 	mousePos.y -= windowPos.y;
 	mousePos.y /= scale;
 
-	// Add rays
-	rays.clear();
-	for (uint8_t i = 0; i < raysCount; i++) {
-		Ray r;
-		r.points.push_back({0.05f, 0.25f + raysGap * i});
-		rays.push_back(r);
+	// Add rays, paths of previous frame keep their memory
+	size_t raysCount = 0;
+	for (auto& s : sources) raysCount += s.count();
+	rays.resize(raysCount);
+	raysCount = 0;
+	for (auto& s : sources) {
+		s.emit(&rays[raysCount]);
+		raysCount += s.count();
+	}
+
+	// Optimizer moves elements before they are drawn, first screen is its
+	// target
+	int target = -1;
+	for (size_t i = 0; i < lens.size() && target < 0; i++)
+		if (lens[i].type == Lens::Type::screen) target = i;
+	if (optimizer.running) {
+		optimizer.step(lens, sources, target);
+		if (target < 0 || optimizer.converged()) optimizer.running = false;
 	}
 
 	// Calculate lens points
@@ -61,10 +221,36 @@ void Optics::draw() {
 		l.begin = {l.position.x + diff.x, l.position.y + diff.y};
 		l.end = {l.position.x - diff.x, l.position.y - diff.y};
 	}
+	tracer.setElements(lens);
+	// Paraxial rays replace exact ones, unless both are compared
+	bool useParaxial = paraxialMode && paraxial.build(lens, sources);
+	bool traceExact = !useParaxial || compareExact;
+
+	// Light gathered over frames, drawn under elements
+	if (showIrradiance) {
+		irradiance.update(tracer, sources, windowSize, scale);
+		irradiance.draw(draw, windowPos);
+	}
 
 	// Draw lens
-	for (auto& l : lens) {
-		if (l.type == Lens::Type::biconvex || l.type == Lens::Type::biconcave) {
+	static vector<ImVec2> outline;
+	for (size_t i = 0; i < lens.size(); i++) {
+		Lens& l = lens[i];
+		if (l.type == Lens::Type::thickLens || l.type == Lens::Type::prism) {
+			tracer.outline(i, outline);
+			for (auto& p : outline)
+				p = ImVec2(p.x * scale + windowPos.x,
+						   p.y * scale + windowPos.y);
+			draw->AddConvexPolyFilled(outline.data(), outline.size(),
+									  ImColor(120, 200, 255, 60));
+			draw->AddPolyline(outline.data(), outline.size(),
+							  ImColor(120, 200, 255), ImDrawFlags_Closed,
+							  2.0f);
+			draw->AddCircleFilled(ImVec2{l.position.x * scale + windowPos.x,
+										 l.position.y * scale + windowPos.y},
+								  5.0f, ImColor(255, 0, 0));
+		} else if (l.type == Lens::Type::biconvex ||
+				   l.type == Lens::Type::biconcave) {
 			ImVec2 begin = {l.begin.x * scale + windowPos.x,
 							l.begin.y * scale + windowPos.y},
 				   end = {l.end.x * scale + windowPos.x,
@@ -102,166 +288,440 @@ void Optics::draw() {
 			draw->AddCircleFilled(ImVec2{l.position.x * scale + windowPos.x,
 										 l.position.y * scale + windowPos.y},
 								  5.0f, ImColor(255, 0, 0));
+		} else if (l.type == Lens::Type::convexMirror) {
+			// Arc around center of curvature behind vertex
+			float radius = std::max(2 * l.principalFocus, 1e-6f),
+				  spread = asin(std::min(l.height / 2 / radius, 1.0f)),
+				  facing = l.angle + (float)M_PI / 2;
+			ImVec2 center = {l.position.x - cos(facing) * radius,
+							 l.position.y - sin(facing) * radius};
+			vector<ImVec2> points;
+			for (int k = 0; k <= 16; k++) {
+				float a = facing - spread + 2 * spread * k / 16;
+				points.push_back(
+					{(center.x + radius * cos(a)) * scale + windowPos.x,
+					 (center.y + radius * sin(a)) * scale + windowPos.y});
+			}
+			draw->AddPolyline(points.data(), points.size(),
+							  ImColor(255, 0, 0), 0, 5.0f);
+			draw->AddCircleFilled(ImVec2{l.position.x * scale + windowPos.x,
+										 l.position.y * scale + windowPos.y},
+								  5.0f, ImColor(255, 0, 0));
+		} else {
+			// Flat mirror, aperture and screen lie on segment
+			ImVec2 begin = {l.begin.x * scale + windowPos.x,
+							l.begin.y * scale + windowPos.y},
+				   end = {l.end.x * scale + windowPos.x,
+						  l.end.y * scale + windowPos.y},
+				   center = {l.position.x * scale + windowPos.x,
+							 l.position.y * scale + windowPos.y};
+			if (l.type == Lens::Type::aperture) {
+				float hole = std::min(l.opening / l.height, 1.0f);
+				for (auto& x : {begin, end})
+					draw->AddLine(
+						x,
+						ImVec2(center.x + (x.x - center.x) * hole,
+							   center.y + (x.y - center.y) * hole),
+						ImColor(160, 160, 160), 6.0f);
+			} else {
+				draw->AddLine(begin, end,
+							  l.type == Lens::Type::screen
+								  ? ImColor(255, 255, 255)
+								  : ImColor(255, 0, 0),
+							  l.type == Lens::Type::screen ? 3.0f : 5.0f);
+			}
+			draw->AddCircleFilled(center, 5.0f, ImColor(255, 0, 0));
 		}
 	}
 
-	// Calculate Rays
-	unsigned long totalRayVertex = 0;
-	for (auto& r : rays) {
-		tuple<int8_t, ImVec2, float, float> closest = {-1, {0, 0}, 0, 0};
-		for (int8_t current = 0; current < lens.size(); current++) {
-			Lens& l = lens[current];
-			ImVec2& p = r.points.back();
-			r._angle = fmodf(r._angle + 2 * M_PI, 2 * M_PI);
-			float lensAngles[2] = {angleBetweenPoints(p, l.begin),
-								   angleBetweenPoints(p, l.end)};
-			float max = std::max(lensAngles[0], lensAngles[1]),
-				  min = std::min(lensAngles[0], lensAngles[1]);
-
-			// Checks ray hit and update informations
-			if (l.type == Lens::Type::biconvex ||
-				l.type == Lens::Type::biconcave) {
-				// For lens
-				if ((max - min < M_PI && r._angle < max && r._angle > min) ||
-					(max - min > M_PI && (r._angle < min || r._angle > max))) {
-					ImVec2 hitPoint = l.position;
-
-					float d =
-						-sin(angleBetweenPoints(p, l.position) - r._angle) *
-						distanceBetweenPoints(p, l.position) /
-						sin(r._angle - l.angle);
-					hitPoint.x -= cos(l.angle) * d;
-					hitPoint.y -= sin(l.angle) * d;
-					float distance = distanceBetweenPoints(p, hitPoint);
-
-					if (distanceBetweenPoints(p, hitPoint) > 1e-6f &&
-						(get<0>(closest) == -1 ||
-						 distanceBetweenPoints(p, hitPoint) <
-							 get<2>(closest))) {
-						closest = {current, hitPoint,
-								   distanceBetweenPoints(p, hitPoint), d};
-					}
-				}
-			} else if (l.type == Lens::Type::concaveReflector) {
-				// For concave reflector
-				float rs = distanceBetweenPoints(p, l.position);
-				float theta = r._angle - angleBetweenPoints(p, l.position);
-				float b = 2 * rs * cos(theta);
-				float delta =
-					pow(b, 2) - (4 * (pow(rs, 2) - pow(l.principalFocus, 2)));
-				if (delta >= 0) {
-					vector<ImVec2> hitPoints;
-					for (auto& q : {-1, 1}) {
-						float x = (b + (sqrt(delta) * q)) / 2;
-						if (x > 0) {
-							ImVec2 hp = p;
-							hp.x += x * cos(r._angle);
-							hp.y += x * sin(r._angle);
-							hitPoints.push_back(hp);
-						}
-					}
-					for (int8_t x = 0; x < hitPoints.size(); x++) {
-						auto& hp = hitPoints[x];
-						float angle = angleBetweenPoints(l.position, hp);
-						if ((l.angle + l.angleSize > 2 * M_PI &&
-							 angle < l.angle &&
-							 angle > fmodf(l.angle + l.angleSize, 2 * M_PI)) ||
-							(l.angle + l.angleSize <= 2 * M_PI &&
-							 (angle < l.angle ||
-							  angle > l.angle + l.angleSize))) {
-							hitPoints.erase(hitPoints.begin() + x);
-							x -= 1;
-						}
-					}
-					if (hitPoints.size() > 0) {
-						ImVec2 hitPoint;
-						if (hitPoints.size() == 1) {
-							hitPoint = hitPoints.back();
-						} else {
-							if (distanceBetweenPoints(hitPoints[0], p) <
-								distanceBetweenPoints(hitPoints[1], p)) {
-								hitPoint = hitPoints[0];
-							} else {
-								hitPoint = hitPoints[1];
-							}
-						}
-						if (distanceBetweenPoints(p, hitPoint) > 1e-6f &&
-							(get<0>(closest) == -1 ||
-							 distanceBetweenPoints(p, hitPoint) <
-								 get<2>(closest))) {
-							closest = {
-								current, hitPoint,
-								distanceBetweenPoints(p, hitPoint),
-								angleBetweenPoints(l.position, hitPoint)};
-						}
-					}
-				}
-			}
+	// Calculate Rays, only new rays and rays meeting changed elements.
+	// Skipped rays miss changes of elements, so they are traced again later.
+	parallelFor(
+		rays.size(),
+		[&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+				rays[i].traced = traceExact && !tracer.needsTrace(rays[i]);
+		},
+		64);
+	retraced.clear();
+	for (auto& r : rays)
+		if (!r.traced && traceExact) retraced.push_back(&r);
+	size_t packets =
+		(retraced.size() + Tracer::packetSize - 1) / Tracer::packetSize;
+	parallelFor(packets, [&](size_t begin, size_t end) {
+		for (size_t p = begin; p < end; p++) {
+			size_t first = p * Tracer::packetSize;
+			tracer.tracePacket(&retraced[first],
+							   std::min(retraced.size() - first,
+										(size_t)Tracer::packetSize));
+		}
+	});
+
+	// Light falling on screens, counted in bins along them
+	const int screenBins = 64;
+	static vector<int> screenSlot;	// Per element, -1 for other than screen
+	static vector<float> profile;
+	int screens = 0;
+	screenSlot.assign(lens.size(), -1);
+	for (size_t i = 0; i < lens.size(); i++)
+		if (lens[i].type == Lens::Type::screen) screenSlot[i] = screens++;
+	profile.assign(screens * screenBins, 0.0f);
+	if (screens > 0 && traceExact) {
+		for (auto& r : rays) {
+			if (r.escaped || r.hits.empty() || screenSlot[r.hits.back()] < 0)
+				continue;
+			const Lens& l = lens[r.hits.back()];
+			const ImVec2& p = r.points.back();
+			float along = ((p.x - l.position.x) * cos(l.angle) +
+						   (p.y - l.position.y) * sin(l.angle)) /
+							  l.height +
+						  0.5f;
+			int bin = std::min(std::max((int)(along * screenBins), 0),
+							   screenBins - 1);
+			profile[screenSlot[r.hits.back()] * screenBins + bin] += 1;
+		}
+	}
 
-			if (current == lens.size() - 1 && get<0>(closest) != -1) {
-				Lens& cl = lens[get<0>(closest)];  // Closest lens
-
-				// Angle calculation process from:
-				// https://physics.stackexchange.com/questions/690925/what-is-the-angle-of-a-ray-passing-through-a-thin-lens
-				if (cl.type == Lens::Type::biconvex) {
-					r._angle = atan(tan((-M_PI / 2) - cl.angle + r._angle) +
-									(get<3>(closest) / cl.principalFocus)) +
-							   r._angle;
-					r.points.push_back(get<1>(closest));
-					totalRayVertex++;
+	// Paraxial rays need no search for elements, so all of them are traced
+	// every frame
+	if (useParaxial) {
+		paraxialRays.resize(rays.size());
+		parallelFor(
+			rays.size(),
+			[&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++) {
+					Ray& r = paraxialRays[i];
+					r.origin = rays[i].origin;
+					r.direction = rays[i].direction;
+					r.wavelength = rays[i].wavelength;
+					paraxial.trace(r);
 				}
-				if (cl.type == Lens::Type::biconcave) {
-					r._angle = -atan(tan((-M_PI / 2) - cl.angle + r._angle) +
-									 (get<3>(closest) / cl.principalFocus)) +
-							   r._angle;
-					r.points.push_back(get<1>(closest));
-					totalRayVertex++;
-				}
-				if (cl.type == Lens::Type::concaveReflector) {
-					r._angle =
-						2 * angleBetweenPoints(cl.position, get<1>(closest)) +
-						M_PI - r._angle;
-					r.points.push_back(get<1>(closest));
-					totalRayVertex++;
+			},
+			64);
+	}
+
+	// Largest angle between leaving exact and paraxial rays, which passed
+	// same number of surfaces
+	largestDifference = 0.0f;
+	comparedRays = 0;
+	if (useParaxial && compareExact) {
+		for (size_t i = 0; i < rays.size(); i++) {
+			const Ray& r = rays[i];
+			ImVec2 origin, direction;
+			if (!r.escaped ||
+				r.points.size() != paraxialRays[i].points.size() ||
+				!paraxial.map(r, origin, direction))
+				continue;
+			const ImVec2 &a = r.points[r.points.size() - 2],
+						 &b = r.points.back();
+			ImVec2 exact(b.x - a.x, b.y - a.y);
+			float angle = std::fabs(std::atan2(
+				exact.x * direction.y - exact.y * direction.x,
+				exact.x * direction.x + exact.y * direction.y));
+			largestDifference = std::max(largestDifference, angle);
+			comparedRays++;
+		}
+	}
+
+	// Draw rays in colors of their light, dense beams are thinner and
+	// translucent. Irradiance replaces them.
+	float rayThickness = rays.size() > 100 ? 1.0f : 3.0f;
+	float rayAlpha = rays.size() > 1000 ? 0.25f : 1.0f;
+	// Compared paraxial rays are white and thin over exact ones.
+	if (!showIrradiance) {
+		for (auto& r : traceExact ? rays : paraxialRays) {
+			for (auto& p : r.points) {
+				draw->PathLineTo(ImVec2(p.x * scale + windowPos.x,
+										p.y * scale + windowPos.y));
+			}
+			ImVec4 color = spectrumColor(r.wavelength);
+			color.w = rayAlpha;
+			draw->PathStroke(ImColor(color), 0, rayThickness);
+		}
+		if (useParaxial && compareExact) {
+			for (auto& r : paraxialRays) {
+				for (auto& p : r.points) {
+					draw->PathLineTo(ImVec2(p.x * scale + windowPos.x,
+											p.y * scale + windowPos.y));
 				}
-				closest = {-1, {0, 0}, 0, 0};
-				if (totalRayVertex < 1 << 13) current = -1;
+				draw->PathStroke(ImColor(1.0f, 1.0f, 1.0f, rayAlpha), 0,
+								 1.0f);
 			}
 		}
-		ImVec2 re = r.points.back();
-		re.x += cos(r._angle) * 10;
-		re.y += sin(r._angle) * 10;
-		r.points.push_back(re);
-		r._angle = 0;
 	}
 
-	// Draw rays
-	for (auto& r : rays) {
-		for (auto& p : r.points) {
-			draw->PathLineTo(
-				ImVec2(p.x * scale + windowPos.x, p.y * scale + windowPos.y));
+	// Profiles of screens rise in front of them, scaled to their brightest
+	// bin
+	for (size_t i = 0; i < lens.size(); i++) {
+		if (screenSlot[i] < 0) continue;
+		const Lens& l = lens[i];
+		const float* bins = &profile[screenSlot[i] * screenBins];
+		float brightest = *std::max_element(bins, bins + screenBins);
+		if (brightest == 0) continue;
+		ImVec2 tangent = {cos(l.angle), sin(l.angle)},
+			   side = {-tangent.y, tangent.x};
+		for (int k = 0; k < screenBins; k++) {
+			float along = ((k + 0.5f) / screenBins - 0.5f) * l.height,
+				  rise = bins[k] / brightest * 40.0f;
+			draw->PathLineTo(ImVec2(
+				(l.position.x + tangent.x * along) * scale + side.x * rise +
+					windowPos.x,
+				(l.position.y + tangent.y * along) * scale + side.y * rise +
+					windowPos.y));
+		}
+		draw->PathStroke(ImColor(255, 255, 0), 0, 2.0f);
+	}
+
+	// Optical axis with focal points, principal planes and images of
+	// sources
+	if (useParaxial) {
+		auto toScreen = [&](const ImVec2& p) {
+			return ImVec2(p.x * scale + windowPos.x, p.y * scale + windowPos.y);
+		};
+		ImVec2 a = toScreen(paraxial.onAxis(-paraxial.escapeDistance)),
+			   b = toScreen(paraxial.onAxis(paraxial.escapeDistance));
+		draw->AddLine(a, b, ImColor(255, 255, 255, 80), 1.0f);
+		Paraxial::Cardinal c = paraxial.cardinal();
+		if (std::isfinite(c.focalLength)) {
+			ImVec2 across(-(b.y - a.y), b.x - a.x);
+			float length = std::sqrt(across.x * across.x + across.y * across.y);
+			across = ImVec2(across.x / length * 15, across.y / length * 15);
+			for (float z : {c.frontPrincipal, c.backPrincipal}) {
+				ImVec2 p = toScreen(paraxial.onAxis(z));
+				draw->AddLine(ImVec2(p.x - across.x, p.y - across.y),
+							  ImVec2(p.x + across.x, p.y + across.y),
+							  ImColor(120, 200, 255), 2.0f);
+			}
+			draw->AddText(toScreen(paraxial.onAxis(c.frontPrincipal)),
+						  ImColor(120, 200, 255), "H");
+			draw->AddText(toScreen(paraxial.onAxis(c.backPrincipal)),
+						  ImColor(120, 200, 255), "H'");
+			ImVec2 front = toScreen(paraxial.onAxis(c.frontFocus)),
+				   back = toScreen(paraxial.onAxis(c.backFocus));
+			draw->AddCircleFilled(front, 4.0f, ImColor(255, 150, 0));
+			draw->AddCircleFilled(back, 4.0f, ImColor(255, 150, 0));
+			draw->AddText(front, ImColor(255, 150, 0), "F");
+			draw->AddText(back, ImColor(255, 150, 0), "F'");
+		}
+		for (auto& s : sources) {
+			ImVec2 image;
+			float magnification;
+			if (s.type != Source::Type::parallel &&
+				paraxial.image(s.position, image, magnification))
+				draw->AddCircle(toScreen(image), 7.0f, ImColor(255, 255, 0),
+								0, 2.0f);
 		}
-		draw->PathStroke(ImColor(255, 255, 0), 0, 3);
-		ImVec2 copy = r.points.front();
-		r.points = {copy};
+	}
+
+	// Draw sources
+	for (auto& s : sources) {
+		draw->AddCircleFilled(ImVec2(s.position.x * scale + windowPos.x,
+									 s.position.y * scale + windowPos.y),
+							  5.0f, ImColor(255, 255, 0));
 	}
 
 	// Menu
 	if (ImGui::BeginMenuBar()) {
 		if (ImGui::BeginMenu(tr("Options").c_str())) {
-			ImGui::SliderInt(tr("Rays count").c_str(), (int*)&raysCount, 0, 50,
-							 "%i", ImGuiSliderFlags_AlwaysClamp);
-			ImGui::DragFloat(
-				tr("Rays gap").c_str(), &raysGap, 6e-2f, 1e-3f, 100.0f,
-				"%.3f m",
-				ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_AlwaysClamp);
 			ImGui::DragFloat(
 				tr("Scale").c_str(), &scale, 100.0f, 10.0f, 1000000.0f,
 				"%.2f px = 1 m",
 				ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_AlwaysClamp);
+			ImGui::DragInt(tr("Bounces limit").c_str(), &tracer.maxBounces,
+						   1.0f, 1, 10000, "%d", ImGuiSliderFlags_AlwaysClamp);
+			ImGui::Checkbox(tr("Wave optics").c_str(), &showWave);
 
 			ImGui::EndMenu();
 		}
+		if (ImGui::BeginMenu(tr("Sources").c_str())) {
+			std::string parallel = tr("Parallel beam"), point = tr("Point"),
+						fan = tr("Fan");
+			const char* types[] = {parallel.c_str(), point.c_str(),
+								   fan.c_str()};
+			for (size_t i = 0; i < sources.size(); i++) {
+				Source& s = sources[i];
+				ImGui::PushID(i);
+				int type = s.type;
+				ImGui::SetNextItemWidth(120);
+				if (ImGui::Combo("##Type", &type, types, IM_ARRAYSIZE(types)))
+					s.type = (Source::Type)type;
+				ImGui::SameLine();
+				ImGui::SetNextItemWidth(100);
+				ImGui::DragInt(tr("Rays count").c_str(), &s.rays, 1.0f, 1,
+							   100000, "%d", ImGuiSliderFlags_AlwaysClamp);
+				ImGui::DragInt(tr("Wavelengths").c_str(), &s.wavelengths,
+							   0.1f, 1, 64, "%d", ImGuiSliderFlags_AlwaysClamp);
+				if (s.type == Source::Type::parallel) {
+					ImGui::DragFloat(tr("Width").c_str(), &s.size, 1e-3f, 0.0f,
+									 100.0f, "%.3f m",
+									 ImGuiSliderFlags_AlwaysClamp);
+				} else if (s.type == Source::Type::fan) {
+					ImGui::SliderAngle(tr("Spread").c_str(), &s.size, 0.0f,
+									   360.0f);
+				}
+				if (s.type != Source::Type::point)
+					ImGui::SliderAngle(tr("Direction").c_str(), &s.angle,
+									   -180.0f, 180.0f);
+				if (ImGui::Button(tr("Remove").c_str())) {
+					sources.erase(sources.begin() + i);
+					movedSource = NULL;
+				}
+				ImGui::Separator();
+				ImGui::PopID();
+			}
+			for (int t = 0; t < IM_ARRAYSIZE(types); t++) {
+				if (t > 0) ImGui::SameLine();
+				ImGui::PushID(t);
+				if (ImGui::Button(
+						(tr("Add") + " " + std::string(types[t])).c_str())) {
+					Source s;
+					s.type = (Source::Type)t;
+					s.position = ImVec2(windowSize.x / scale / 4,
+										windowSize.y / scale / 2);
+					s.rays = 1000;
+					if (s.type == Source::Type::fan) s.size = M_PI / 8;
+					sources.push_back(s);
+					movedSource = NULL;
+				}
+				ImGui::PopID();
+			}
+			ImGui::Text("%s: %zu (%zu)", tr("Rays count").c_str(), rays.size(),
+						retraced.size());
+			ImGui::EndMenu();
+		}
+		if (ImGui::BeginMenu(tr("Irradiance").c_str())) {
+			ImGui::Checkbox(tr("Show irradiance").c_str(), &showIrradiance);
+			ImGui::DragInt(tr("Rays per frame").c_str(),
+						   &irradiance.raysPerFrame, 100.0f, 100, 1000000, "%d",
+						   ImGuiSliderFlags_Logarithmic |
+							   ImGuiSliderFlags_AlwaysClamp);
+			ImGui::SliderFloat(tr("Exposure").c_str(), &irradiance.exposure,
+							   0.01f, 100.0f, "%.2f",
+							   ImGuiSliderFlags_Logarithmic);
+			ImGui::SliderInt(tr("Resolution").c_str(), &irradiance.pixelStep,
+							 1, 8, "%d px", ImGuiSliderFlags_AlwaysClamp);
+			ImGui::Text("%s: %d / %d", tr("Accumulated frames").c_str(),
+						irradiance.frames(), Irradiance::maxFrames);
+			ImGui::EndMenu();
+		}
+		if (ImGui::BeginMenu(tr("Paraxial").c_str())) {
+			ImGui::Checkbox(tr("Paraxial mode").c_str(), &paraxialMode);
+			ImGui::Checkbox(tr("Compare with exact tracer").c_str(),
+							&compareExact);
+			if (paraxialMode && !useParaxial) {
+				ImGui::Text("%s",
+							tr("Lenses do not share optical axis").c_str());
+				if (ImGui::Button(tr("Align on axis").c_str()))
+					Paraxial::align(lens);
+			} else if (useParaxial) {
+				Paraxial::Cardinal c = paraxial.cardinal();
+				ImGui::Separator();
+				if (std::isfinite(c.focalLength)) {
+					ImGui::Text("%s: %.4f m", tr("Focal length").c_str(),
+								c.focalLength);
+					ImGui::TextDisabled(
+						"%s", tr("Distances from outer elements").c_str());
+					ImGui::Text("%s: %.4f m",
+								tr("Front focal distance").c_str(),
+								c.first - c.frontFocus);
+					ImGui::Text("%s: %.4f m", tr("Back focal distance").c_str(),
+								c.backFocus - c.last);
+					ImGui::Text("%s: %.4f m, %.4f m",
+								tr("Principal planes").c_str(),
+								c.frontPrincipal - c.first,
+								c.backPrincipal - c.last);
+				} else {
+					ImGui::Text("%s", tr("Afocal system").c_str());
+				}
+				for (size_t i = 0; i < sources.size(); i++) {
+					ImVec2 image;
+					float magnification;
+					if (sources[i].type == Source::Type::parallel ||
+						!paraxial.image(sources[i].position, image,
+										magnification))
+						continue;
+					ImGui::Text("%s %zu: (%.3f, %.3f) m, %.3fx",
+								tr("Image of source").c_str(), i + 1, image.x,
+								image.y, magnification);
+				}
+				if (compareExact)
+					ImGui::Text(
+						"%s: %.4f° (%zu)",
+						tr("Largest difference from exact rays").c_str(),
+						largestDifference * 180 / (float)M_PI, comparedRays);
+			}
+			ImGui::EndMenu();
+		}
+		if (ImGui::BeginMenu(tr("Optimizer").c_str())) {
+			if (target < 0)
+				ImGui::Text("%s", tr("Add screen as target plane").c_str());
+			// Parameters which optimizer may change
+			std::string labels[] = {tr("X"), tr("Y"), tr("Angle"),
+									tr("Focus")};
+			for (size_t i = 0; i < lens.size(); i++) {
+				const Lens& l = lens[i];
+				if (l.type == Lens::Type::screen) continue;
+				bool focusing = l.type == Lens::Type::biconvex ||
+								l.type == Lens::Type::biconcave ||
+								l.type == Lens::Type::thickLens ||
+								l.type == Lens::Type::convexMirror ||
+								l.type == Lens::Type::concaveReflector;
+				ImGui::PushID(i);
+				ImGui::Text("%s %zu", tr("Element").c_str(), i + 1);
+				for (int k = 0; k <= Optimizer::focus; k++) {
+					if (k == Optimizer::focus && !focusing) break;
+					bool on = optimizer.chosen(i, (Optimizer::Kind)k);
+					ImGui::SameLine();
+					if (ImGui::Checkbox(labels[k].c_str(), &on))
+						optimizer.choose(i, (Optimizer::Kind)k, on);
+				}
+				ImGui::PopID();
+			}
+			ImGui::Separator();
+			ImGui::DragInt(tr("Rays per candidate").c_str(),
+						   &optimizer.raysLimit, 10.0f, 10, 100000, "%d",
+						   ImGuiSliderFlags_Logarithmic |
+							   ImGuiSliderFlags_AlwaysClamp);
+			if (ImGui::Button(optimizer.running ? tr("Stop").c_str()
+												: tr("Start").c_str())) {
+				optimizer.running = !optimizer.running && target >= 0;
+				if (optimizer.running) optimizer.reset();
+			}
+			ImGui::Text("%s: %d", tr("Iterations").c_str(),
+						optimizer.iterations());
+			ImGui::Text("%s: %.4f mm", tr("Spot size").c_str(),
+						optimizer.spot() * 1000);
+			ImGui::Text("%s: %.0f", tr("Traces per second").c_str(),
+						optimizer.tracesPerSecond());
+			ImGui::EndMenu();
+		}
+		if (ImGui::BeginMenu(tr("Elements").c_str())) {
+			// Grid of small reflectors turned in different directions
+			ImGui::DragInt(tr("Count").c_str(), &mirrorArrayCount, 1.0f, 1,
+						   10000, "%d", ImGuiSliderFlags_AlwaysClamp);
+			if (ImGui::Button(tr("Add mirror array").c_str())) {
+				int side = std::ceil(std::sqrt(mirrorArrayCount));
+				float cell = std::min(windowSize.x, windowSize.y) / scale / 2 /
+							 side;
+				for (int i = 0; i < mirrorArrayCount; i++) {
+					Lens l;
+					l.type = Lens::Type::concaveReflector;
+					l.position = {windowSize.x / scale / 2 +
+									  (i % side - side / 2.0f + 0.5f) * cell,
+								  windowSize.y / scale / 2 +
+									  (i / side - side / 2.0f + 0.5f) * cell};
+					l.principalFocus = cell * 0.4f;
+					l.height = l.principalFocus;
+					l.angle = fmodf(i * 2.39996323f, 2 * M_PI);
+					lens.push_back(l);
+				}
+			}
+			if (ImGui::Button(tr("Remove all").c_str())) {
+				lens.clear();
+				optimizer.clear();
+			}
+			ImGui::EndMenu();
+		}
 		ImGui::EndMenuBar();
 	}
 
@@ -293,8 +753,11 @@ void Optics::draw() {
 			"ModifyObject", NULL,
 			ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize)) {
 		ImGui::SetWindowSize({200, 0});
-		if (onModify->type == Lens::Type::biconvex ||
-			onModify->type == Lens::Type::biconcave) {
+		bool focusing = onModify->type == Lens::Type::biconvex ||
+						onModify->type == Lens::Type::biconcave ||
+						onModify->type == Lens::Type::thickLens ||
+						onModify->type == Lens::Type::convexMirror;
+		if (focusing) {
 			ImGui::Text("%s", tr("Height").c_str());
 			ImGui::DragFloat(
 				"##Height", &(onModify->height), 5e-4f, 1e-3f,
@@ -310,28 +773,63 @@ void Optics::draw() {
 				ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_AlwaysClamp);
 
 			ImGui::Text("%s m", tr("Radius").c_str());
+		} else if (onModify->type == Lens::Type::prism) {
+			ImGui::Text("%s", tr("Side length").c_str());
+			ImGui::DragFloat(
+				"##Height", &(onModify->height), 5e-4f, 1e-3f, 5.0f, "%.3f m",
+				ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_AlwaysClamp);
+			ImGui::Text("%s", tr("Apex angle").c_str());
+			ImGui::SliderAngle("##AngleSize", &(onModify->angleSize), 1.0f,
+							   179.0f);
+		} else {
+			ImGui::Text("%s", tr("Height").c_str());
+			ImGui::DragFloat(
+				"##Height", &(onModify->height), 5e-4f, 1e-3f, 5.0f, "%.3f m",
+				ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_AlwaysClamp);
+		}
+		if (onModify->type == Lens::Type::aperture) {
+			ImGui::Text("%s", tr("Opening").c_str());
+			ImGui::DragFloat("##Opening", &(onModify->opening), 5e-4f, 0.0f,
+							 onModify->height, "%.3f m",
+							 ImGuiSliderFlags_AlwaysClamp);
+		}
+		if (focusing || onModify->type == Lens::Type::concaveReflector)
+			ImGui::DragFloat(
+				"##PrincipalFocus", &(onModify->principalFocus), 4e-3f,
+				onModify->height / 2, 5.0f, "%.3f m",
+				ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_AlwaysClamp);
+		if (onModify->type == Lens::Type::thickLens ||
+			onModify->type == Lens::Type::prism) {
+			// Cauchy coefficients, default is crown glass
+			ImGui::Text("%s", tr("Refractive index").c_str());
+			ImGui::DragFloat("##CauchyA", &(onModify->cauchyA), 1e-3f, 1.01f,
+							 3.0f, "%.4f", ImGuiSliderFlags_AlwaysClamp);
+			ImGui::Text("%s", tr("Dispersion").c_str());
+			ImGui::DragFloat("##CauchyB", &(onModify->cauchyB), 1e-4f, 0.0f,
+							 0.1f, "%.4f um^2", ImGuiSliderFlags_AlwaysClamp);
 		}
-		ImGui::DragFloat(
-			"##PrincipalFocus", &(onModify->principalFocus), 4e-3f,
-			onModify->height / 2, 5.0f, "%.3f m",
-			ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_AlwaysClamp);
 
 		ImGui::Text("%s", tr("Type").c_str());
-		const char* Biconvex = tr("Biconvex").c_str();
-		const char* Biconcave = tr("Biconcave").c_str();
-		const char* ConcaveReflector = tr("Concave reflector").c_str();
-		const char* types[] = {Biconvex, Biconcave, "ConcaveReflector"};
-		ImGui::ListBox("##Types", &modifySelectedType, types,
-					   IM_ARRAYSIZE(types));
-		if (modifySelectedType != -1) {
-			if (modifySelectedType == 0) onModify->type = Lens::Type::biconvex;
-			if (modifySelectedType == 1) onModify->type = Lens::Type::biconcave;
-			if (modifySelectedType == 2)
-				onModify->type = Lens::Type::concaveReflector;
+		std::string biconvex = tr("Biconvex"), biconcave = tr("Biconcave"),
+					reflector = tr("Concave reflector"),
+					thick = tr("Thick lens"), prism = tr("Prism"),
+					flat = tr("Flat mirror"), convex = tr("Convex mirror"),
+					aperture = tr("Aperture"), screen = tr("Screen");
+		const char* types[] = {biconvex.c_str(), biconcave.c_str(),
+							   reflector.c_str(), thick.c_str(),
+							   prism.c_str(), flat.c_str(),
+							   convex.c_str(), aperture.c_str(),
+							   screen.c_str()};
+		if (ImGui::ListBox("##Types", &modifySelectedType, types,
+						   IM_ARRAYSIZE(types))) {
+			onModify->type = (Lens::Type)modifySelectedType;
+			if (onModify->type == Lens::Type::prism)
+				onModify->angleSize = M_PI / 3;
 		}
 
 		if (ImGui::Button(tr("Remove").c_str())) {
 			auto iter = find(lens.begin(), lens.end(), *onModify);
+			optimizer.erase(iter - lens.begin());
 			lens.erase(iter);
 			onModify = NULL;
 			ImGui::CloseCurrentPopup();
@@ -355,23 +853,37 @@ void Optics::draw() {
 		}
 	}
 
-	// Move lens
+	// Move lens or source
 	static Lens* onMove = NULL;
 	if (ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
-		if (onMove == NULL) {
+		if (onMove == NULL && movedSource == NULL) {
 			for (auto& l : lens) {
 				float distance = distanceBetweenPoints(l.position, mousePos);
 				if (distance * scale < 30) {
 					onMove = &l;
 				}
 			}
+			for (auto& s : sources) {
+				float distance = distanceBetweenPoints(s.position, mousePos);
+				if (onMove == NULL && distance * scale < 10) {
+					movedSource = &s;
+				}
+			}
 		}
 	} else if (ImGui::IsMouseDown(ImGuiMouseButton_Left) && onMove != NULL) {
 		onMove->position.x += IO.MouseDelta.x / scale;
 		onMove->position.y += IO.MouseDelta.y / scale;
-	} else if (ImGui::IsMouseReleased(ImGuiMouseButton_Left))
+	} else if (ImGui::IsMouseDown(ImGuiMouseButton_Left) &&
+			   movedSource != NULL) {
+		movedSource->position.x += IO.MouseDelta.x / scale;
+		movedSource->position.y += IO.MouseDelta.y / scale;
+	} else if (ImGui::IsMouseReleased(ImGuiMouseButton_Left)) {
 		onMove = NULL;
+		movedSource = NULL;
+	}
 
 	draw->PushClipRectFullScreen();
 	ImGui::End();
+
+	if (showWave) drawWave(wave, &showWave);
 }
\ No newline at end of file
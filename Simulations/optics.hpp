@@ -3,6 +3,7 @@
 
 #include <imgui.h>
 
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
@@ -10,9 +11,54 @@
 #include "../view.hpp"
 
 namespace Optic {
+// Yellow sodium line, refractive index of glass is given for it
+const float sodiumWavelength = 589.3f;
+// Approximate color of visible light, wavelength in nm
+ImVec4 spectrumColor(float wavelength);
+// Cauchy's equation for refractive index of glass, wavelength in nm
+inline float cauchy(float a, float b, float wavelength) {
+	float micrometers = wavelength * 1e-3f;
+	return a + b / (micrometers * micrometers);
+}
+
 struct Ray {
-	std::vector<ImVec2> points;
-	float _angle = 0;  // Circle unit angle in radians for calculations only.
+	ImVec2 origin = {0, 0};
+	ImVec2 direction = {1, 0};	 // Unit vector
+	std::vector<ImVec2> points;	 // Traced path starting at origin
+	std::vector<int> hits;		 // Elements met along path
+	float wavelength = sodiumWavelength;  // In nm
+	bool escaped = false;		 // Left scene, else stopped or out of bounces
+	bool traced = false;		 // Path matches origin and direction
+};
+
+struct Source {
+	enum Type { parallel, point, fan };
+	Type type = parallel;
+	ImVec2 position = {0.05f, 0.325f};	// Center of beam
+	float angle = 0.0f;					// Direction of beam in radians
+	float size = 0.15f;	 // Width of parallel beam in m, fan spread in rad
+	int rays = 4;
+	int wavelengths = 1;  // Samples of visible spectrum per ray
+	int count() const { return rays * wavelengths; }
+	// Wavelength of sample from 0 to wavelengths - 1, spectrum spans 400 to
+	// 700 nm
+	float wavelength(int sample) const {
+		return wavelengths > 1 ? 400 + 300 * (sample + 0.5f) / wavelengths
+							   : sodiumWavelength;
+	}
+	bool operator==(const Source& s) const {
+		return type == s.type && position.x == s.position.x &&
+			   position.y == s.position.y && angle == s.angle &&
+			   size == s.size && rays == s.rays &&
+			   wavelengths == s.wavelengths;
+	}
+	bool operator!=(const Source& s) const { return !(*this == s); }
+	// Origin and direction of ray at place t from -0.5 to 0.5 across beam
+	void place(float t, ImVec2& origin, ImVec2& direction) const;
+	// Sets origin, direction and wavelength of rays[0 .. count()), changed
+	// rays are marked for tracing. Wavelengths of one ray are next to each
+	// other, so they are traced in one packet.
+	void emit(Ray* rays) const;
 };
 
 struct Lens {
@@ -25,15 +71,39 @@ struct Lens {
 	enum Type {	 // https://en.wikipedia.org/wiki/Lens#/media/File:Lenses_en.svg
 		biconvex,
 		biconcave,
-		concaveReflector
+		concaveReflector,
+		thickLens,	// Glass lens with both surfaces of same radius
+		prism,		// Glass triangle, angleSize is its apex angle
+		flatMirror,
+		convexMirror,  // Bulges against its axis, radius is 2 principalFocus
+		aperture,	   // Opaque with hole of opening in its middle
+		screen		   // Opaque, shows light falling on it
 	};
 	Type type;
-	bool operator==(const Lens l) {
+	float opening = 0.05f;  // Of aperture, in m
+	// Glass of thick lens and prism, index n = A + B / λ², λ in μm
+	float cauchyA = 1.5046f, cauchyB = 0.0042f;
+	bool operator==(const Lens& l) const {
 		return (this->position.x == l.position.x &&
 				this->position.y == l.position.y && this->height == l.height &&
-				this->angle == l.angle &&
+				this->angle == l.angle && this->angleSize == l.angleSize &&
 				this->principalFocus == l.principalFocus &&
-				this->type == l.type);
+				this->type == l.type && this->cauchyA == l.cauchyA &&
+				this->cauchyB == l.cauchyB && this->opening == l.opening);
+	}
+	// Refractive index of glass, wavelength in nm
+	float index(float wavelength) const {
+		return cauchy(cauchyA, cauchyB, wavelength);
+	}
+	// Surfaces of thick lens have radius from lensmaker's equation of thin
+	// lens and meet at rim, so its thickness follows from height
+	float surfaceRadius() const {
+		return std::max(2 * (index(sodiumWavelength) - 1) * principalFocus,
+						1e-6f);
+	}
+	float halfThickness() const {
+		float r = surfaceRadius(), half = std::min(height / 2, r);
+		return r - std::sqrt(r * r - half * half);
 	}
 	ImVec2 getHitPoint(const Ray& r);
 };
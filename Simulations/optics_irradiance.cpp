@@ -0,0 +1,267 @@
+#include "optics_irradiance.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "../parallel.hpp"
+
+using namespace Optic;
+
+namespace {
+// Cuts segment to its part inside box, false when it misses box
+bool clip(ImVec2& a, ImVec2& b, const ImVec2& min, const ImVec2& max) {
+	float enter = 0, exit = 1;
+	float from[2] = {a.x, a.y}, d[2] = {b.x - a.x, b.y - a.y},
+		  low[2] = {min.x, min.y}, high[2] = {max.x, max.y};
+	for (int axis = 0; axis < 2; axis++) {
+		if (d[axis] == 0) {
+			if (from[axis] < low[axis] || from[axis] > high[axis]) return false;
+			continue;
+		}
+		float t1 = (low[axis] - from[axis]) / d[axis],
+			  t2 = (high[axis] - from[axis]) / d[axis];
+		enter = std::max(enter, std::min(t1, t2));
+		exit = std::min(exit, std::max(t1, t2));
+	}
+	if (enter > exit) return false;
+	b = ImVec2(from[0] + d[0] * exit, from[1] + d[1] * exit);
+	a = ImVec2(from[0] + d[0] * enter, from[1] + d[1] * enter);
+	return true;
+}
+}  // namespace
+
+void Irradiance::update(const Tracer& tracer,
+						const std::vector<Source>& sources, const ImVec2& size,
+						float scale) {
+	int w = std::ceil(std::max(size.x, 1.0f) / pixelStep / tileSize),
+		h = std::ceil(std::max(size.y, 1.0f) / pixelStep / tileSize);
+	if (w * tileSize != width || h * tileSize != height ||
+		pixelStep != evaluatedStep || scale != evaluatedScale ||
+		tracer.revision() != revision || sources != lastSources) {
+		tilesX = w;
+		tilesY = h;
+		width = w * tileSize;
+		height = h * tileSize;
+		evaluatedStep = pixelStep;
+		evaluatedScale = scale;
+		revision = tracer.revision();
+		lastSources = sources;
+		accumulated = 0;
+		mappedExposure = 0.0f;
+		sums.assign(width * height * 3, 0.0f);
+		tiles.assign(tilesX * tilesY, Tile());
+		pixels.assign(width * height, 0);
+	}
+	int total = 0;
+	for (auto& s : sources) total += s.count();
+	if (accumulated >= maxFrames || total == 0) {
+		// Nothing to add, image is only mapped again for new exposure
+		if (exposure == mappedExposure && !texture.empty()) return;
+	} else {
+		// Rays are traced and binned to tiles in chunks, then every tile
+		// is filled by one thread from bins of all chunks
+		int chunks = std::max(workerCount(), 1u);
+		rays.resize(chunks);
+		bins.resize(chunks);
+		for (auto& b : bins) b.resize(tiles.size());
+		parallelFor(chunks, [&](size_t begin, size_t end) {
+			for (size_t c = begin; c < end; c++)
+				traceChunk(tracer, sources, c, chunks, scale);
+		});
+		parallelFor(tiles.size(), [&](size_t begin, size_t end) {
+			for (size_t t = begin; t < end; t++) depositTile(t);
+		});
+		accumulated++;
+	}
+
+	// Average lit cell is mapped to middle of brightness
+	double light = 0;
+	long lit = 0;
+	for (auto& t : tiles) {
+		light += t.light;
+		lit += t.lit;
+	}
+	float gain = lit > 0 ? exposure * 0.5f * 3 * lit / light : 0.0f;
+	parallelFor(tiles.size(), [&](size_t begin, size_t end) {
+		for (size_t t = begin; t < end; t++) toneMapTile(t, gain);
+	});
+	mappedExposure = exposure;
+	texture.upload(pixels.data(), width, height);
+}
+
+void Irradiance::draw(ImDrawList* drawList, const ImVec2& origin) const {
+	if (texture.empty()) return;
+	drawList->AddImage(texture.id(), origin,
+					   ImVec2(origin.x + width * evaluatedStep,
+							  origin.y + height * evaluatedStep));
+}
+
+void Irradiance::traceChunk(const Tracer& tracer,
+							const std::vector<Source>& sources, int chunk,
+							int chunks, float scale) {
+	// Rays of frame are split between sources by their counts and spread
+	// evenly over each beam with random shift
+	int total = 0;
+	for (auto& s : sources) total += s.count();
+	std::minstd_rand random(accumulated * 7919 + chunk + 1);
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+	size_t begin = (size_t)raysPerFrame * chunk / chunks,
+		   end = (size_t)raysPerFrame * (chunk + 1) / chunks;
+	std::vector<Ray>& chunkRays = rays[chunk];
+	chunkRays.resize(end - begin);
+	size_t first = 0;
+	int counted = 0;
+	for (auto& s : sources) {
+		counted += s.count();
+		size_t last = (size_t)raysPerFrame * counted / total;
+		for (size_t k = std::max(first, begin); k < std::min(last, end); k++) {
+			Ray& ray = chunkRays[k - begin];
+			s.place((k - first + uniform(random)) / (last - first) - 0.5f,
+					ray.origin, ray.direction);
+			ray.wavelength = s.wavelengths > 1 ? 400 + 300 * uniform(random)
+											   : sodiumWavelength;
+		}
+		first = last;
+	}
+
+	for (size_t i = 0; i < chunkRays.size(); i += Tracer::packetSize) {
+		Ray* packet[Tracer::packetSize];
+		int count = std::min(chunkRays.size() - i, (size_t)Tracer::packetSize);
+		for (int j = 0; j < count; j++) packet[j] = &chunkRays[i + j];
+		tracer.tracePacket(packet, count);
+	}
+
+	std::vector<std::vector<Segment>>& tileBins = bins[chunk];
+	for (auto& b : tileBins) b.clear();
+	float cell = scale / evaluatedStep;
+	for (auto& ray : chunkRays) {
+		ImVec4 color = spectrumColor(ray.wavelength);
+		for (size_t i = 1; i < ray.points.size(); i++) {
+			const ImVec2 &a = ray.points[i - 1], &b = ray.points[i];
+			bin(tileBins, ImVec2(a.x * cell, a.y * cell),
+				ImVec2(b.x * cell, b.y * cell), color);
+		}
+	}
+}
+
+// Segment goes to every tile it passes with margin of one cell, which its
+// light reaches
+void Irradiance::bin(std::vector<std::vector<Segment>>& tileBins, ImVec2 a,
+					 ImVec2 b, const ImVec4& color) const {
+	if (!clip(a, b, ImVec2(-1, -1), ImVec2(width + 1, height + 1))) return;
+	Segment segment = {a, b, color.x, color.y, color.z};
+	int ty0 = std::max((int)std::floor((std::min(a.y, b.y) - 1) / tileSize),
+					   0),
+		ty1 = std::min((int)std::floor((std::max(a.y, b.y) + 1) / tileSize),
+					   tilesY - 1);
+	for (int ty = ty0; ty <= ty1; ty++) {
+		// Part of segment between rows of tile
+		float xa = std::min(a.x, b.x), xb = std::max(a.x, b.x);
+		if (a.y != b.y) {
+			float t0 = (ty * tileSize - 1 - a.y) / (b.y - a.y),
+				  t1 = ((ty + 1) * tileSize + 1 - a.y) / (b.y - a.y);
+			t0 = std::min(std::max(t0, 0.0f), 1.0f);
+			t1 = std::min(std::max(t1, 0.0f), 1.0f);
+			xa = a.x + (b.x - a.x) * t0;
+			xb = a.x + (b.x - a.x) * t1;
+			if (xa > xb) std::swap(xa, xb);
+		}
+		int tx0 = std::max((int)std::floor((xa - 1) / tileSize), 0),
+			tx1 = std::min((int)std::floor((xb + 1) / tileSize), tilesX - 1);
+		for (int tx = tx0; tx <= tx1; tx++)
+			tileBins[ty * tilesX + tx].push_back(segment);
+	}
+}
+
+void Irradiance::depositTile(int tile) {
+	int x0 = (tile % tilesX) * tileSize, y0 = (tile / tilesX) * tileSize;
+	float* tileSums = &sums[(size_t)tile * tileSize * tileSize * 3];
+	ImVec2 min(x0 - 1, y0 - 1), max(x0 + tileSize + 1, y0 + tileSize + 1);
+	for (auto& chunk : bins) {
+		for (const Segment& s : chunk[tile]) {
+			ImVec2 a = s.from, b = s.to;
+			if (!clip(a, b, min, max)) continue;
+			// Walks cells along longer axis u, light of each is split
+			// between two nearest cells across it on axis v
+			bool steep = std::fabs(b.y - a.y) > std::fabs(b.x - a.x);
+			float au = steep ? a.y : a.x, av = steep ? a.x : a.y,
+				  bu = steep ? b.y : b.x, bv = steep ? b.x : b.y;
+			if (au > bu) {
+				std::swap(au, bu);
+				std::swap(av, bv);
+			}
+			if (bu <= au) continue;
+			float slope = (bv - av) / (bu - au),
+				  length = std::sqrt(1 + slope * slope);
+			// Coordinates within tile
+			int u0 = steep ? y0 : x0, v0 = steep ? x0 : y0;
+			au -= u0;
+			bu -= u0;
+			av -= v0;
+			int first = std::max((int)std::floor(au), 0),
+				last = std::min((int)std::ceil(bu) - 1, tileSize - 1);
+			// Cells along u are tileSize apart in buffer when it is y
+			int step = steep ? tileSize : 1, across = steep ? 1 : tileSize;
+			float v = av + slope * (first + 0.5f - au) - 0.5f;
+			float red = s.red, green = s.green, blue = s.blue;
+			for (int u = first; u <= last; u++, v += slope) {
+				// Only end cells are covered in part. Row is floor of v,
+				// which is above -2 thanks to margin.
+				float weight = length;
+				if (u == first || u == last)
+					weight *= std::min(bu, u + 1.0f) - std::max(au, (float)u);
+				int row = (int)(v + 4) - 4;
+				float second = weight * (v - row),
+					  w[2] = {weight - second, second};
+				for (int k = 0; k < 2; k++) {
+					if ((unsigned)(row + k) >= (unsigned)tileSize) continue;
+					float* sum =
+						&tileSums[3 * (u * step + (row + k) * across)];
+					sum[0] += red * w[k];
+					sum[1] += green * w[k];
+					sum[2] += blue * w[k];
+				}
+			}
+		}
+	}
+
+	Tile& t = tiles[tile];
+	t.light = 0.0f;
+	t.lit = 0;
+	for (int i = 0; i < tileSize * tileSize; i++) {
+		const float* sum = &tileSums[3 * i];
+		float light = sum[0] + sum[1] + sum[2];
+		t.light += light;
+		t.lit += light > 0;
+	}
+}
+
+// Reinhard curve with gamma of 2, alpha is brightest channel so image
+// only adds light to background
+void Irradiance::toneMapTile(int tile, float gain) {
+	int x0 = (tile % tilesX) * tileSize, y0 = (tile / tilesX) * tileSize;
+	const float* sum = &sums[(size_t)tile * tileSize * tileSize * 3];
+	for (int y = y0; y < y0 + tileSize; y++) {
+		for (int x = x0; x < x0 + tileSize; x++, sum += 3) {
+			if (sum[0] + sum[1] + sum[2] == 0) {
+				pixels[(size_t)y * width + x] = 0;
+				continue;
+			}
+			float c[3];
+			for (int i = 0; i < 3; i++) {
+				float v = sum[i] * gain;
+				c[i] = std::sqrt(v / (1 + v));
+			}
+			float alpha = std::max(std::max(c[0], c[1]), c[2]);
+			uint32_t pixel = (uint32_t)(alpha * 255 + 0.5f) << 24;
+			for (int i = 0; i < 3; i++)
+				pixel |= (uint32_t)(c[i] / alpha * 255 + 0.5f) << (16 - 8 * i);
+			pixels[(size_t)y * width + x] = pixel;
+		}
+	}
+}
@@ -0,0 +1,65 @@
+#ifndef OPTICS_IRRADIANCE_H
+#define OPTICS_IRRADIANCE_H
+
+#include <imgui.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "../texture.hpp"
+#include "optics.hpp"
+#include "optics_trace.hpp"
+
+namespace Optic {
+// Light density summed from paths of rays into texture. Every frame new
+// rays at random places of beams are traced and added, so the image gets
+// smoother while scene stays still and caustics show as bright envelopes.
+class Irradiance {
+   public:
+	int raysPerFrame = 2000;
+	int pixelStep = 1;		// Screen pixels per cell of buffer
+	float exposure = 1.0f;	// Multiplies automatic exposure
+	static const int maxFrames = 500;  // Image hardly changes after them
+
+	int frames() const { return accumulated; }
+	// Buffer is cleared when elements, sources or view change
+	void update(const Tracer& tracer, const std::vector<Source>& sources,
+				const ImVec2& size, float scale);
+	void draw(ImDrawList* drawList, const ImVec2& origin) const;
+
+   private:
+	static const int tileSize = 64;	 // Cells per side of tile
+	struct Segment {
+		ImVec2 from, to;  // In cells
+		float red, green, blue;
+	};
+	struct Tile {
+		float light = 0.0f;	 // Sum of brightness of lit cells
+		int lit = 0;
+	};
+
+	int width = 0, height = 0, tilesX = 0, tilesY = 0;
+	int evaluatedStep = 0;
+	float evaluatedScale = 0.0f;
+	unsigned revision = 0;
+	std::vector<Source> lastSources;
+	int accumulated = 0;
+	float mappedExposure = 0.0f;
+	std::vector<float> sums;  // RGB per cell, tile after tile
+	std::vector<Tile> tiles;
+	// Per chunk of rays, traced on one thread
+	std::vector<std::vector<Ray>> rays;
+	std::vector<std::vector<std::vector<Segment>>> bins;  // Per tile
+	std::vector<uint32_t> pixels;
+	Texture texture;
+
+	void traceChunk(const Tracer& tracer, const std::vector<Source>& sources,
+					int chunk, int chunks, float scale);
+	void bin(std::vector<std::vector<Segment>>& tileBins, ImVec2 a, ImVec2 b,
+			 const ImVec4& color) const;
+	void depositTile(int tile);
+	void toneMapTile(int tile, float gain);
+};
+}  // namespace Optic
+
+#endif
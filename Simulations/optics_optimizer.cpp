@@ -0,0 +1,182 @@
+#include "optics_optimizer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "../parallel.hpp"
+
+using namespace Optic;
+
+namespace {
+const float firstSize[] = {0.01f, 0.01f, 0.02f, 0.01f};	 // Per kind
+const float smallestSize = 1e-6f;
+
+float& value(Lens& l, Optimizer::Kind kind) {
+	switch (kind) {
+		case Optimizer::x:
+			return l.position.x;
+		case Optimizer::y:
+			return l.position.y;
+		case Optimizer::angle:
+			return l.angle;
+		case Optimizer::focus:
+			break;
+	}
+	return l.principalFocus;
+}
+}  // namespace
+
+bool Optimizer::chosen(int element, Kind kind) const {
+	for (auto& p : parameters)
+		if (p.element == element && p.kind == kind) return true;
+	return false;
+}
+
+void Optimizer::choose(int element, Kind kind, bool on) {
+	if (on == chosen(element, kind)) return;
+	if (on) {
+		parameters.push_back({element, kind});
+		sizes.push_back(firstSize[kind]);
+		return;
+	}
+	for (size_t i = 0; i < parameters.size(); i++) {
+		if (parameters[i].element == element && parameters[i].kind == kind) {
+			parameters.erase(parameters.begin() + i);
+			sizes.erase(sizes.begin() + i);
+			return;
+		}
+	}
+}
+
+void Optimizer::erase(int element) {
+	for (size_t i = parameters.size(); i-- > 0;) {
+		if (parameters[i].element > element) {
+			parameters[i].element--;
+		} else if (parameters[i].element == element) {
+			parameters.erase(parameters.begin() + i);
+			sizes.erase(sizes.begin() + i);
+		}
+	}
+}
+
+void Optimizer::clear() {
+	parameters.clear();
+	sizes.clear();
+	running = false;
+}
+
+void Optimizer::reset() {
+	for (size_t i = 0; i < parameters.size(); i++)
+		sizes[i] = firstSize[parameters[i].kind];
+	steps = 0;
+}
+
+bool Optimizer::converged() const {
+	for (float s : sizes)
+		if (s > smallestSize) return false;
+	return true;
+}
+
+bool Optimizer::step(std::vector<Lens>& lens,
+					 const std::vector<Source>& sources, int target) {
+	// Parameters of removed elements are dropped
+	for (size_t i = parameters.size(); i-- > 0;) {
+		if (parameters[i].element < (int)lens.size()) continue;
+		parameters.erase(parameters.begin() + i);
+		sizes.erase(sizes.begin() + i);
+	}
+	if (target < 0 || target >= (int)lens.size()) return false;
+	auto start = std::chrono::steady_clock::now();
+
+	// Same sample of rays for every candidate
+	size_t total = 0;
+	for (auto& s : sources) total += s.count();
+	emitted.resize(total);
+	total = 0;
+	for (auto& s : sources) {
+		s.emit(&emitted[total]);
+		total += s.count();
+	}
+	size_t sampled = std::min(total, (size_t)raysLimit);
+
+	// First candidate is lens as it is, then each parameter up and down
+	size_t count = 1 + 2 * parameters.size();
+	candidates.resize(count);
+	tracers.resize(count);
+	rays.resize(count);
+	scores.resize(count);
+	for (size_t c = 0; c < count; c++) {
+		candidates[c] = lens;
+		rays[c].resize(sampled);
+		for (size_t i = 0; i < sampled; i++) {
+			const Ray& r = emitted[i * total / sampled];
+			rays[c][i].origin = r.origin;
+			rays[c][i].direction = r.direction;
+			rays[c][i].wavelength = r.wavelength;
+		}
+		if (c == 0) continue;
+		int p = (c - 1) / 2;
+		Lens& l = candidates[c][parameters[p].element];
+		float& v = value(l, parameters[p].kind);
+		v += c % 2 ? sizes[p] : -sizes[p];
+		// Lens can't be shorter than its height allows
+		if (parameters[p].kind == focus)
+			v = std::max(v, std::max(l.height / 2, 1e-3f));
+	}
+	parallelFor(count, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; c++) scores[c] = evaluate(c, target);
+	});
+
+	size_t best =
+		std::min_element(scores.begin(), scores.end()) - scores.begin();
+	score = scores[0];
+	steps++;
+	double seconds = std::chrono::duration<double>(
+						 std::chrono::steady_clock::now() - start)
+						 .count();
+	speed = seconds > 0 ? count * sampled / seconds : 0.0;
+	if (best == 0 || scores[best] >= scores[0] * (1 - 1e-6f)) {
+		for (float& s : sizes) s /= 2;
+		return false;
+	}
+	// Successful direction grows its step
+	lens = candidates[best];
+	int p = (best - 1) / 2;
+	sizes[p] = std::min(sizes[p] * 1.5f, firstSize[parameters[p].kind]);
+	return true;
+}
+
+float Optimizer::evaluate(int candidate, int target) {
+	Tracer& tracer = tracers[candidate];
+	const std::vector<Lens>& lens = candidates[candidate];
+	std::vector<Ray>& traced = rays[candidate];
+	tracer.setElements(lens);
+	for (size_t i = 0; i < traced.size(); i += Tracer::packetSize) {
+		Ray* packet[Tracer::packetSize];
+		int count = std::min(traced.size() - i, (size_t)Tracer::packetSize);
+		for (int j = 0; j < count; j++) packet[j] = &traced[i + j];
+		tracer.tracePacket(packet, count);
+	}
+
+	// Place of hit along target screen
+	const Lens& screen = lens[target];
+	ImVec2 tangent(std::cos(screen.angle), std::sin(screen.angle));
+	double sum = 0, squares = 0;
+	int hits = 0;
+	for (auto& r : traced) {
+		if (r.escaped || r.hits.empty() || r.hits.back() != target) continue;
+		const ImVec2& p = r.points.back();
+		double h = (p.x - screen.position.x) * tangent.x +
+				   (p.y - screen.position.y) * tangent.y;
+		sum += h;
+		squares += h * h;
+		hits++;
+	}
+	if (traced.empty()) return 0.0f;
+	double spread = hits > 0 ? squares - sum * sum / hits : 0.0;
+	double missed = (double)(traced.size() - hits) * screen.height *
+					screen.height;
+	return std::sqrt(std::max(spread + missed, 0.0) / traced.size());
+}
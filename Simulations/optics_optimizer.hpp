@@ -0,0 +1,60 @@
+#ifndef OPTICS_OPTIMIZER_H
+#define OPTICS_OPTIMIZER_H
+
+#include <vector>
+
+#include "optics.hpp"
+#include "optics_trace.hpp"
+
+namespace Optic {
+// Moves chosen parameters of elements so rays meet in smallest spot on
+// target screen. Every step tries each parameter one step both ways,
+// all candidates are traced at once on worker threads. Best one is kept,
+// when none is better steps are halved (compass search).
+class Optimizer {
+   public:
+	enum Kind { x, y, angle, focus };
+	struct Parameter {
+		int element;
+		Kind kind;
+	};
+	int raysLimit = 1000;  // Rays sampled from sources per candidate
+	bool running = false;
+
+	bool chosen(int element, Kind kind) const;
+	void choose(int element, Kind kind, bool on);
+	// Drops parameters of removed element, later elements move down
+	void erase(int element);
+	void clear();
+	// Steps and count of iterations start again
+	void reset();
+	// Changes lens to best candidate, false when none was better. Target
+	// is index of screen.
+	bool step(std::vector<Lens>& lens, const std::vector<Source>& sources,
+			  int target);
+	// Spot of lens before last step, in m
+	float spot() const { return score; }
+	int iterations() const { return steps; }
+	double tracesPerSecond() const { return speed; }
+	// Steps are too small to change anything
+	bool converged() const;
+
+   private:
+	std::vector<Parameter> parameters;
+	std::vector<float> sizes;  // Step of each parameter
+	std::vector<std::vector<Lens>> candidates;
+	std::vector<Tracer> tracers;  // Per candidate
+	std::vector<std::vector<Ray>> rays;
+	std::vector<float> scores;
+	std::vector<Ray> emitted;
+	float score = 0.0f;
+	int steps = 0;
+	double speed = 0.0;
+
+	// Root mean square distance of hits from their mean, rays missing
+	// target add height of target each
+	float evaluate(int candidate, int target);
+};
+}  // namespace Optic
+
+#endif
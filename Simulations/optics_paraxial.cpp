@@ -0,0 +1,245 @@
+#include "optics_paraxial.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace Optic;
+
+namespace {
+float dot(const ImVec2& a, const ImVec2& b) { return a.x * b.x + a.y * b.y; }
+
+bool refracting(const Lens& l) {
+	return l.type == Lens::Type::biconvex || l.type == Lens::Type::biconcave ||
+		   l.type == Lens::Type::thickLens;
+}
+}  // namespace
+
+bool Paraxial::build(const std::vector<Lens>& lens,
+					 const std::vector<Source>& sources) {
+	// Only glass depends on wavelength
+	std::vector<float> needed = {sodiumWavelength};
+	for (auto& l : lens) {
+		if (l.type != Lens::Type::thickLens) continue;
+		for (auto& s : sources)
+			for (int w = 0; w < s.wavelengths; w++)
+				needed.push_back(s.wavelength(w));
+		break;
+	}
+	std::sort(needed.begin(), needed.end());
+	needed.erase(std::unique(needed.begin(), needed.end()), needed.end());
+	if (lens == lastLens && needed == wavelengths) return shared;
+	lastLens = lens;
+	wavelengths = needed;
+	forward.clear();
+	backward.clear();
+
+	shared = !lens.empty();
+	for (auto& l : lens) shared = shared && refracting(l);
+	if (!shared) return false;
+	origin = lens[0].position;
+	side = ImVec2(std::cos(lens[0].angle), std::sin(lens[0].angle));
+	axis = ImVec2(-side.y, side.x);
+	// Light mostly goes to the right, front of system is on its left
+	if (axis.x < 0 || (axis.x == 0 && axis.y < 0)) {
+		axis = ImVec2(-axis.x, -axis.y);
+		side = ImVec2(-side.x, -side.y);
+	}
+	for (auto& l : lens) {
+		ImVec2 offset(l.position.x - origin.x, l.position.y - origin.y);
+		if (std::fabs(std::sin(l.angle - lens[0].angle)) > 1e-4f ||
+			std::fabs(dot(offset, side)) > 1e-5f)
+			shared = false;
+	}
+	if (!shared) return false;
+
+	forward.resize(wavelengths.size());
+	backward.resize(wavelengths.size());
+	for (size_t i = 0; i < wavelengths.size(); i++) {
+		buildSystem(lens, wavelengths[i], 1, forward[i]);
+		buildSystem(lens, wavelengths[i], -1, backward[i]);
+	}
+	return true;
+}
+
+// Lenses are symmetric, so backward system is the same one with positions
+// turned around
+void Paraxial::buildSystem(const std::vector<Lens>& lens, float wavelength,
+						   float sign, System& system) const {
+	std::vector<Plane>& planes = system.planes;
+	planes.clear();
+	for (auto& l : lens) {
+		ImVec2 offset(l.position.x - origin.x, l.position.y - origin.y);
+		float z = sign * dot(offset, axis);
+		if (l.type == Lens::Type::thickLens) {
+			// Refraction on sphere n1 u1 = n2 u2 + (n2 - n1) h / r, first
+			// surface has its center behind it and second one before it
+			float n = l.index(wavelength), r = l.surfaceRadius(),
+				  half = l.halfThickness();
+			planes.push_back({z - half, (1 - n) / (n * r), 1 / n});
+			planes.push_back({z + half, (1 - n) / r, n});
+		} else {
+			float focus = l.type == Lens::Type::biconcave ? -l.principalFocus
+														  : l.principalFocus;
+			planes.push_back({z, -1 / focus, 1});
+		}
+	}
+	std::sort(planes.begin(), planes.end(),
+			  [](const Plane& a, const Plane& b) { return a.z < b.z; });
+
+	// Composed from last plane, flight between planes is [1 d; 0 1]
+	system.suffix.resize(planes.size());
+	Matrix m = {1, 0, 0, 1};
+	for (int i = (int)planes.size() - 1; i >= 0; i--) {
+		if (i + 1 < (int)planes.size()) {
+			float d = planes[i + 1].z - planes[i].z;
+			m = {m.a, m.a * d + m.b, m.c, m.c * d + m.d};
+		}
+		const Plane& p = planes[i];
+		m = {m.a + m.b * p.c, m.b * p.d, m.c + m.d * p.c, m.d * p.d};
+		system.suffix[i] = m;
+	}
+}
+
+const Paraxial::System* Paraxial::place(const Ray& ray, float& sign,
+										float& z, float& y,
+										float& slope) const {
+	float along = dot(ray.direction, axis);
+	if (!shared || std::fabs(along) < 1e-6f) return NULL;
+	sign = along > 0 ? 1.0f : -1.0f;
+	ImVec2 offset(ray.origin.x - origin.x, ray.origin.y - origin.y);
+	z = sign * dot(offset, axis);
+	y = dot(offset, side);
+	slope = dot(ray.direction, side) / std::fabs(along);
+	// Without glass there is only system of sodium light
+	size_t i = std::lower_bound(wavelengths.begin(), wavelengths.end(),
+								ray.wavelength) -
+			   wavelengths.begin();
+	if (i >= wavelengths.size() || wavelengths[i] != ray.wavelength)
+		i = std::lower_bound(wavelengths.begin(), wavelengths.end(),
+							 sodiumWavelength) -
+			wavelengths.begin();
+	return sign > 0 ? &forward[i] : &backward[i];
+}
+
+ImVec2 Paraxial::point(float sign, float z, float y) const {
+	return ImVec2(origin.x + axis.x * sign * z + side.x * y,
+				  origin.y + axis.y * sign * z + side.y * y);
+}
+
+void Paraxial::trace(Ray& ray) const {
+	ray.points.clear();
+	ray.hits.clear();
+	ray.points.push_back(ray.origin);
+	ray.escaped = true;
+	ray.traced = false;
+	ImVec2 direction = ray.direction;
+	float sign, z, y, slope;
+	const System* system = place(ray, sign, z, y, slope);
+	if (system != NULL) {
+		auto first = std::upper_bound(
+			system->planes.begin(), system->planes.end(), z,
+			[](float z, const Plane& p) { return z < p.z; });
+		for (auto p = first; p != system->planes.end(); p++) {
+			y += slope * (p->z - z);
+			z = p->z;
+			slope = p->c * y + p->d * slope;
+			ray.points.push_back(point(sign, z, y));
+		}
+		if (first != system->planes.end()) {
+			float length = std::sqrt(1 + slope * slope);
+			direction = ImVec2((axis.x * sign + side.x * slope) / length,
+							   (axis.y * sign + side.y * slope) / length);
+		}
+	}
+	const ImVec2& last = ray.points.back();
+	ray.points.push_back(ImVec2(last.x + direction.x * escapeDistance,
+								last.y + direction.y * escapeDistance));
+}
+
+bool Paraxial::map(const Ray& ray, ImVec2& origin, ImVec2& direction) const {
+	float sign, z, y, slope;
+	const System* system = place(ray, sign, z, y, slope);
+	if (system == NULL) return false;
+	auto first =
+		std::upper_bound(system->planes.begin(), system->planes.end(), z,
+						 [](float z, const Plane& p) { return z < p.z; });
+	size_t i = first - system->planes.begin();
+	if (i == system->planes.size()) return false;
+	y += slope * (system->planes[i].z - z);
+	const Matrix& m = system->suffix[i];
+	float height = m.a * y + m.b * slope;
+	slope = m.c * y + m.d * slope;
+	origin = point(sign, system->planes.back().z, height);
+	float length = std::sqrt(1 + slope * slope);
+	direction = ImVec2((axis.x * sign + side.x * slope) / length,
+					   (axis.y * sign + side.y * slope) / length);
+	return true;
+}
+
+// For matrix [A B; C D] from first to last plane: f = -1 / C, back focus
+// lies -A / C behind last plane and front focus -D / C before first one
+Paraxial::Cardinal Paraxial::cardinal() const {
+	const float infinity = std::numeric_limits<float>::infinity();
+	Cardinal c = {infinity, infinity, infinity, infinity,
+				  infinity, infinity, infinity};
+	if (!shared) return c;
+	size_t i = std::lower_bound(wavelengths.begin(), wavelengths.end(),
+								sodiumWavelength) -
+			   wavelengths.begin();
+	const System& s = forward[i];
+	const Matrix& m = s.suffix[0];
+	c.first = s.planes.front().z;
+	c.last = s.planes.back().z;
+	if (std::fabs(m.c) < 1e-9f) return c;
+	c.focalLength = -1 / m.c;
+	c.backFocus = c.last - m.a / m.c;
+	c.backPrincipal = c.last + (1 - m.a) / m.c;
+	c.frontFocus = c.first + m.d / m.c;
+	c.frontPrincipal = c.first + (m.d - 1) / m.c;
+	return c;
+}
+
+ImVec2 Paraxial::onAxis(float z) const { return point(1, z, 0); }
+
+// Object s before first plane is imaged s' behind last one, where flight
+// matrices around system make B zero: s' = -(A s + B) / (C s + D)
+bool Paraxial::image(const ImVec2& object, ImVec2& image,
+					 float& magnification) const {
+	if (!shared) return false;
+	size_t i = std::lower_bound(wavelengths.begin(), wavelengths.end(),
+								sodiumWavelength) -
+			   wavelengths.begin();
+	ImVec2 offset(object.x - origin.x, object.y - origin.y);
+	float z = dot(offset, axis), y = dot(offset, side), sign = 1;
+	const System* s = &forward[i];
+	if (z > s->planes.back().z) {
+		s = &backward[i];
+		sign = -1;
+		z = -z;
+	}
+	if (z > s->planes.front().z) return false;
+	const Matrix& m = s->suffix[0];
+	float distance = s->planes.front().z - z,
+		  denominator = m.c * distance + m.d;
+	if (std::fabs(denominator) < 1e-9f) return false;
+	float behind = -(m.a * distance + m.b) / denominator;
+	magnification = m.a + m.c * behind;
+	image = point(sign, s->planes.back().z + behind, magnification * y);
+	return true;
+}
+
+void Paraxial::align(std::vector<Lens>& lens) {
+	if (lens.empty()) return;
+	ImVec2 origin = lens[0].position,
+		   axis(-std::sin(lens[0].angle), std::cos(lens[0].angle));
+	for (auto& l : lens) {
+		float z = dot(ImVec2(l.position.x - origin.x, l.position.y - origin.y),
+					  axis);
+		l.position = ImVec2(origin.x + axis.x * z, origin.y + axis.y * z);
+		l.angle = lens[0].angle;
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef OPTICS_PARAXIAL_H
+#define OPTICS_PARAXIAL_H
+
+#include <imgui.h>
+
+#include <vector>
+
+#include "optics.hpp"
+
+namespace Optic {
+// Lenses on common optical axis as one composed ray transfer matrix. Ray is
+// height and slope against axis, so free flight and thin lens are exact and
+// only surfaces of thick lenses are linearized. Apertures of lenses are not
+// limited.
+class Paraxial {
+   public:
+	float escapeDistance = 10.0f;  // Length of last segment of ray, in m
+
+	// Matrices are rebuilt only when elements or wavelengths of sources
+	// differ from previous call. Returns whether elements share axis.
+	bool build(const std::vector<Lens>& lens,
+			   const std::vector<Source>& sources);
+	bool coaxial() const { return shared; }
+	// Point of axis at position z, which is zero at first element
+	ImVec2 onAxis(float z) const;
+	// Path of ray with point on every element it passes
+	void trace(Ray& ray) const;
+	// Ray leaving last element it passes, false when it passes none. Takes
+	// one composed matrix, however many elements there are.
+	bool map(const Ray& ray, ImVec2& origin, ImVec2& direction) const;
+
+	// For sodium light, as positions along axis. Focal length is infinite
+	// for afocal system.
+	struct Cardinal {
+		float focalLength;
+		float first, last;	// Planes of outer elements or surfaces
+		float frontFocus, backFocus;
+		float frontPrincipal, backPrincipal;
+	};
+	Cardinal cardinal() const;
+	// Image of point and its lateral magnification, false when point lies
+	// between elements or its image is at infinity
+	bool image(const ImVec2& object, ImVec2& image,
+			   float& magnification) const;
+	// Moves elements on axis of first one and turns them like it
+	static void align(std::vector<Lens>& lens);
+
+   private:
+	// Height of ray is kept, slope after plane is c * height + d * slope
+	struct Plane {
+		float z;  // Along axis of system
+		float c, d;
+	};
+	struct Matrix {
+		float a, b, c, d;
+	};
+	// Planes of elements for one wavelength in one direction of flight,
+	// backward system has axis turned around
+	struct System {
+		std::vector<Plane> planes;
+		// From front of plane to last plane
+		std::vector<Matrix> suffix;
+	};
+
+	std::vector<Lens> lastLens;
+	std::vector<float> wavelengths;	 // Sodium is first
+	bool shared = false;
+	ImVec2 origin, axis, side;
+	std::vector<System> forward, backward;	// Per wavelength
+
+	void buildSystem(const std::vector<Lens>& lens, float wavelength,
+					 float sign, System& system) const;
+	// System for flight of ray and its height, slope and place along axis
+	const System* place(const Ray& ray, float& sign, float& z, float& y,
+						float& slope) const;
+	ImVec2 point(float sign, float z, float y) const;
+};
+}  // namespace Optic
+
+#endif
@@ -0,0 +1,1016 @@
+#include "optics_trace.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace Optic;
+
+namespace {
+const float minDistance = 1e-6f;  // Ray can't hit element it leaves
+
+float cross(const ImVec2& a, const ImVec2& b) { return a.x * b.y - a.y * b.x; }
+float dot(const ImVec2& a, const ImVec2& b) { return a.x * b.x + a.y * b.y; }
+
+bool sameGeometry(const Lens& a, const Lens& b) {
+	return a.position.x == b.position.x && a.position.y == b.position.y &&
+		   a.height == b.height && a.angle == b.angle &&
+		   a.angleSize == b.angleSize &&
+		   a.principalFocus == b.principalFocus && a.type == b.type &&
+		   a.cauchyA == b.cauchyA && a.cauchyB == b.cauchyB &&
+		   a.opening == b.opening;
+}
+
+// Same outline, so ray which missed element misses it still. Focus of
+// thin lens and glass only bend rays which hit it, except thickness of
+// thick lens which follows from its glass.
+bool sameShape(const Lens& a, const Lens& b) {
+	bool thin = a.type == Lens::Type::biconvex ||
+				a.type == Lens::Type::biconcave;
+	bool thick = a.type == Lens::Type::thickLens;
+	return a.position.x == b.position.x && a.position.y == b.position.y &&
+		   a.height == b.height && a.angle == b.angle &&
+		   a.angleSize == b.angleSize && a.type == b.type &&
+		   a.opening == b.opening &&
+		   (thin || a.principalFocus == b.principalFocus) &&
+		   (!thick || (a.cauchyA == b.cauchyA && a.cauchyB == b.cauchyB));
+}
+
+// Snell's law on surface of glass with outward unit normal. Ray which
+// can't leave glass is reflected back.
+ImVec2 refract(const ImVec2& direction, ImVec2 normal, float index) {
+	float cosine = -dot(direction, normal), ratio = 1 / index;
+	if (cosine < 0) {
+		normal = ImVec2(-normal.x, -normal.y);
+		cosine = -cosine;
+		ratio = index;
+	}
+	float k = 1 - ratio * ratio * (1 - cosine * cosine);
+	ImVec2 out(direction.x + normal.x * 2 * cosine,
+			   direction.y + normal.y * 2 * cosine);
+	if (k >= 0) {
+		float along = ratio * cosine - std::sqrt(k);
+		out = ImVec2(direction.x * ratio + normal.x * along,
+					 direction.y * ratio + normal.y * along);
+	}
+	float length = std::sqrt(dot(out, out));
+	return ImVec2(out.x / length, out.y / length);
+}
+
+// Direction from arc center lies between its ends
+bool insideArc(const ArcMirror& m, const ImVec2& v) {
+	if (m.wide) return !(cross(m.end, v) > 0 && cross(v, m.start) > 0);
+	return cross(m.start, v) >= 0 && cross(v, m.end) >= 0;
+}
+
+// Distance along ray to box, infinity when missed
+float boxDistance(const ImVec2& min, const ImVec2& max, const ImVec2& origin,
+				  const ImVec2& inverse) {
+	float t1 = (min.x - origin.x) * inverse.x,
+		  t2 = (max.x - origin.x) * inverse.x;
+	float enter = std::min(t1, t2), exit = std::max(t1, t2);
+	t1 = (min.y - origin.y) * inverse.y;
+	t2 = (max.y - origin.y) * inverse.y;
+	enter = std::max(enter, std::min(t1, t2));
+	exit = std::min(exit, std::max(t1, t2));
+	if (exit < std::max(enter, 0.0f))
+		return std::numeric_limits<float>::infinity();
+	return std::max(enter, 0.0f);
+}
+
+bool segmentHitsBox(const ImVec2& a, const ImVec2& b, const ImVec2& min,
+					const ImVec2& max) {
+	float enter = 0, exit = 1;
+	float from[2] = {a.x, a.y}, to[2] = {b.x, b.y}, low[2] = {min.x, min.y},
+		  high[2] = {max.x, max.y};
+	for (int axis = 0; axis < 2; axis++) {
+		float d = to[axis] - from[axis];
+		if (d == 0) {
+			if (from[axis] < low[axis] || from[axis] > high[axis]) return false;
+			continue;
+		}
+		float t1 = (low[axis] - from[axis]) / d,
+			  t2 = (high[axis] - from[axis]) / d;
+		enter = std::max(enter, std::min(t1, t2));
+		exit = std::min(exit, std::max(t1, t2));
+	}
+	return enter <= exit;
+}
+
+// Distance along ray to first crossing with element, false when missed
+bool intersect(const ThinLens& l, const ImVec2& origin,
+			   const ImVec2& direction, float& distance) {
+	float denominator = cross(direction, l.tangent);
+	if (denominator == 0) return false;
+	ImVec2 toCenter(l.center.x - origin.x, l.center.y - origin.y);
+	distance = cross(toCenter, l.tangent) / denominator;
+	float h = cross(toCenter, direction) / denominator;
+	return distance > minDistance && std::fabs(h) <= l.halfHeight;
+}
+
+// Nearer of two crossings with circle which lies on arc
+bool intersect(const ArcMirror& m, const ImVec2& origin,
+			   const ImVec2& direction, float& distance) {
+	ImVec2 fromCenter(origin.x - m.center.x, origin.y - m.center.y);
+	float b = dot(fromCenter, direction),
+		  c = dot(fromCenter, fromCenter) - m.radius * m.radius;
+	float delta = b * b - c;
+	if (delta < 0) return false;
+	float root = std::sqrt(delta);
+	for (float t : {-b - root, -b + root}) {
+		if (t <= minDistance) continue;
+		ImVec2 v(fromCenter.x + direction.x * t,
+				 fromCenter.y + direction.y * t);
+		if (insideArc(m, v)) {
+			distance = t;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Crossing of surface circle lying in circle of other surface
+bool intersect(const ThickLens& l, const ImVec2& origin,
+			   const ImVec2& direction, float& distance) {
+	float radius2 = l.radius * l.radius;
+	distance = std::numeric_limits<float>::infinity();
+	for (float side : {1.0f, -1.0f}) {
+		ImVec2 center(l.center.x + l.axis.x * l.offset * side,
+					  l.center.y + l.axis.y * l.offset * side),
+			other(l.center.x - l.axis.x * l.offset * side,
+				  l.center.y - l.axis.y * l.offset * side);
+		ImVec2 fromCenter(origin.x - center.x, origin.y - center.y);
+		float b = dot(fromCenter, direction),
+			  c = dot(fromCenter, fromCenter) - radius2;
+		float delta = b * b - c;
+		if (delta < 0) continue;
+		float root = std::sqrt(delta);
+		for (float t : {-b - root, -b + root}) {
+			if (t <= minDistance || t >= distance) continue;
+			ImVec2 v(origin.x + direction.x * t - other.x,
+					 origin.y + direction.y * t - other.y);
+			if (dot(v, v) <= radius2) distance = t;
+		}
+	}
+	return distance != std::numeric_limits<float>::infinity();
+}
+
+bool intersect(const Prism& m, const ImVec2& origin, const ImVec2& direction,
+			   float& distance) {
+	distance = std::numeric_limits<float>::infinity();
+	for (int j = 0; j < 3; j++) {
+		const ImVec2& a = m.vertex[j];
+		ImVec2 edge(m.vertex[(j + 1) % 3].x - a.x,
+					m.vertex[(j + 1) % 3].y - a.y);
+		float denominator = cross(direction, edge);
+		if (denominator == 0) continue;
+		ImVec2 toVertex(a.x - origin.x, a.y - origin.y);
+		float t = cross(toVertex, edge) / denominator,
+			  s = cross(toVertex, direction) / denominator;
+		if (t > minDistance && s >= 0 && s <= 1 && t < distance) distance = t;
+	}
+	return distance != std::numeric_limits<float>::infinity();
+}
+
+bool intersect(const FlatMirror& m, const ImVec2& origin,
+			   const ImVec2& direction, float& distance) {
+	float denominator = cross(direction, m.tangent);
+	if (denominator == 0) return false;
+	ImVec2 toCenter(m.center.x - origin.x, m.center.y - origin.y);
+	distance = cross(toCenter, m.tangent) / denominator;
+	float h = cross(toCenter, direction) / denominator;
+	return distance > minDistance && std::fabs(h) <= m.halfHeight;
+}
+
+// Ray going through hole passes
+bool intersect(const Stop& s, const ImVec2& origin, const ImVec2& direction,
+			   float& distance) {
+	float denominator = cross(direction, s.tangent);
+	if (denominator == 0) return false;
+	ImVec2 toCenter(s.center.x - origin.x, s.center.y - origin.y);
+	distance = cross(toCenter, s.tangent) / denominator;
+	float h = std::fabs(cross(toCenter, direction) / denominator);
+	return distance > minDistance && h <= s.outer && h >= s.inner;
+}
+}  // namespace
+
+ImVec4 Optic::spectrumColor(float wavelength) {
+	float r = 0, g = 0, b = 0;
+	if (wavelength < 440) {
+		r = (440 - wavelength) / 60;
+		b = 1;
+	} else if (wavelength < 490) {
+		g = (wavelength - 440) / 50;
+		b = 1;
+	} else if (wavelength < 510) {
+		g = 1;
+		b = (510 - wavelength) / 20;
+	} else if (wavelength < 580) {
+		r = (wavelength - 510) / 70;
+		g = 1;
+	} else if (wavelength < 645) {
+		r = 1;
+		g = (645 - wavelength) / 65;
+	} else {
+		r = 1;
+	}
+	return ImVec4(r, g, b, 1.0f);
+}
+
+void Source::place(float t, ImVec2& origin, ImVec2& direction) const {
+	origin = position;
+	direction = ImVec2(std::cos(angle), std::sin(angle));
+	if (type == parallel) {
+		origin = ImVec2(position.x - direction.y * size * t,
+						position.y + direction.x * size * t);
+	} else {
+		float a = type == point ? 2 * M_PI * (t + 0.5f) : angle + size * t;
+		direction = ImVec2(std::cos(a), std::sin(a));
+	}
+}
+
+void Source::emit(Ray* rays) const {
+	for (int i = 0; i < this->rays; i++) {
+		// Point source spreads rays over whole circle, without repeating
+		// first one at the end
+		float t = type == point		? (float)i / this->rays - 0.5f
+				  : this->rays > 1 ? (float)i / (this->rays - 1) - 0.5f
+								   : 0.0f;
+		ImVec2 origin, direction;
+		place(t, origin, direction);
+		for (int w = 0; w < wavelengths; w++) {
+			float wavelength = this->wavelength(w);
+			Ray& r = rays[i * wavelengths + w];
+			if (r.origin.x != origin.x || r.origin.y != origin.y ||
+				r.direction.x != direction.x ||
+				r.direction.y != direction.y || r.wavelength != wavelength) {
+				r.origin = origin;
+				r.direction = direction;
+				r.wavelength = wavelength;
+				r.traced = false;
+			}
+		}
+	}
+}
+
+bool Tracer::setElements(const std::vector<Lens>& lens) {
+	changedAll = maxBounces != lastBounces || escapeDistance != lastEscape;
+	lastBounces = maxBounces;
+	lastEscape = escapeDistance;
+	changed.assign(lens.size(), 0);
+	changedMin.clear();
+	changedMax.clear();
+	bool same = lens.size() == lastLens.size();
+	for (size_t i = 0; same && i < lens.size(); i++)
+		same = sameGeometry(lens[i], lastLens[i]);
+	if (same && !nodes.empty()) {
+		changes += changedAll;
+		return false;
+	}
+	changes++;
+	std::vector<Lens> previousLens;
+	std::vector<Element> previous;
+	previousLens.swap(lastLens);
+	previous.swap(elements);
+	lastLens = lens;
+
+	thinLenses.clear();
+	arcMirrors.clear();
+	thickLenses.clear();
+	prisms.clear();
+	flatMirrors.clear();
+	stops.clear();
+	elements.clear();
+	for (auto& l : lens) {
+		Element e;
+		ImVec2 tangent(std::cos(l.angle), std::sin(l.angle)),
+			side(-tangent.y, tangent.x);
+		if (l.type == Lens::Type::thickLens) {
+			ThickLens t;
+			t.center = l.position;
+			t.axis = side;
+			t.radius = l.surfaceRadius();
+			float thickness = l.halfThickness(),
+				  half = std::min(l.height / 2, t.radius);
+			t.offset = t.radius - thickness;
+			t.cauchyA = l.cauchyA;
+			t.cauchyB = l.cauchyB;
+			e.min = e.max = l.position;
+			for (float a : {-half, half}) {
+				for (float b : {-thickness, thickness}) {
+					ImVec2 p(l.position.x + tangent.x * a + side.x * b,
+							 l.position.y + tangent.y * a + side.y * b);
+					e.min = ImVec2(std::min(e.min.x, p.x),
+								   std::min(e.min.y, p.y));
+					e.max = ImVec2(std::max(e.max.x, p.x),
+								   std::max(e.max.y, p.y));
+				}
+			}
+			e.type = thickLens;
+			e.index = thickLenses.size();
+			thickLenses.push_back(t);
+		} else if (l.type == Lens::Type::prism) {
+			// Isosceles triangle with legs of lens height around centroid,
+			// apex looks against tangent
+			Prism m;
+			float apex = std::min(std::max(l.angleSize, 0.01f),
+								  (float)M_PI - 0.01f);
+			float altitude = l.height * std::cos(apex / 2),
+				  base = l.height * std::sin(apex / 2);
+			m.vertex[0] = ImVec2(l.position.x - tangent.x * altitude * 2 / 3,
+								 l.position.y - tangent.y * altitude * 2 / 3);
+			for (int i = 1; i < 3; i++) {
+				float s = i == 1 ? base : -base;
+				m.vertex[i] = ImVec2(
+					l.position.x + tangent.x * altitude / 3 + side.x * s,
+					l.position.y + tangent.y * altitude / 3 + side.y * s);
+			}
+			e.min = e.max = m.vertex[0];
+			for (int i = 0; i < 3; i++) {
+				const ImVec2 &a = m.vertex[i], &b = m.vertex[(i + 1) % 3];
+				ImVec2 normal(b.y - a.y, a.x - b.x);
+				float length = std::sqrt(dot(normal, normal));
+				normal = ImVec2(normal.x / length, normal.y / length);
+				if (dot(normal, ImVec2(a.x - l.position.x,
+									   a.y - l.position.y)) < 0)
+					normal = ImVec2(-normal.x, -normal.y);
+				m.normal[i] = normal;
+				e.min = ImVec2(std::min(e.min.x, a.x), std::min(e.min.y, a.y));
+				e.max = ImVec2(std::max(e.max.x, a.x), std::max(e.max.y, a.y));
+			}
+			m.cauchyA = l.cauchyA;
+			m.cauchyB = l.cauchyB;
+			e.type = prism;
+			e.index = prisms.size();
+			prisms.push_back(m);
+		} else if (l.type == Lens::Type::concaveReflector ||
+				   l.type == Lens::Type::convexMirror) {
+			ArcMirror m;
+			if (l.type == Lens::Type::concaveReflector) {
+				m.center = l.position;
+				m.radius = l.principalFocus;
+				m.start = ImVec2(std::cos(l.angle), std::sin(l.angle));
+				m.end = ImVec2(std::cos(l.angle + l.angleSize),
+							   std::sin(l.angle + l.angleSize));
+				m.wide = l.angleSize > M_PI;
+			} else {
+				// Vertex lies at position, center of circle behind it
+				m.radius = std::max(2 * l.principalFocus, 1e-6f);
+				m.center = ImVec2(l.position.x - side.x * m.radius,
+								  l.position.y - side.y * m.radius);
+				float spread =
+						  std::asin(std::min(l.height / 2 / m.radius, 1.0f)),
+					  facing = std::atan2(side.y, side.x);
+				m.start = ImVec2(std::cos(facing - spread),
+								 std::sin(facing - spread));
+				m.end = ImVec2(std::cos(facing + spread),
+							   std::sin(facing + spread));
+				m.wide = false;
+			}
+
+			// Ends and extreme points of circle lying on arc
+			e.min = e.max = ImVec2(m.center.x + m.start.x * m.radius,
+								   m.center.y + m.start.y * m.radius);
+			ImVec2 extremes[] = {m.end, {1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+			for (int i = 0; i < 5; i++) {
+				if (i > 0 && !insideArc(m, extremes[i])) continue;
+				ImVec2 p(m.center.x + extremes[i].x * m.radius,
+						 m.center.y + extremes[i].y * m.radius);
+				e.min = ImVec2(std::min(e.min.x, p.x), std::min(e.min.y, p.y));
+				e.max = ImVec2(std::max(e.max.x, p.x), std::max(e.max.y, p.y));
+			}
+			e.type = arcMirror;
+			e.index = arcMirrors.size();
+			arcMirrors.push_back(m);
+		} else if (l.type == Lens::Type::flatMirror ||
+				   l.type == Lens::Type::aperture ||
+				   l.type == Lens::Type::screen) {
+			float half = l.height / 2;
+			if (l.type == Lens::Type::flatMirror) {
+				e.type = flatMirror;
+				e.index = flatMirrors.size();
+				flatMirrors.push_back({l.position, tangent, half});
+			} else {
+				// Screen is stop without hole
+				float inner = l.type == Lens::Type::aperture
+								  ? std::min(l.opening / 2, half)
+								  : 0.0f;
+				e.type = stop;
+				e.index = stops.size();
+				stops.push_back({l.position, tangent, inner, half});
+			}
+			ImVec2 a(l.position.x + tangent.x * half,
+					 l.position.y + tangent.y * half),
+				b(l.position.x - tangent.x * half,
+				  l.position.y - tangent.y * half);
+			e.min = ImVec2(std::min(a.x, b.x), std::min(a.y, b.y));
+			e.max = ImVec2(std::max(a.x, b.x), std::max(a.y, b.y));
+		} else {
+			ThinLens t;
+			t.center = l.position;
+			t.tangent = tangent;
+			t.halfHeight = l.height / 2;
+			t.focus = l.type == Lens::Type::biconcave ? -l.principalFocus
+													  : l.principalFocus;
+			ImVec2 a(t.center.x + t.tangent.x * t.halfHeight,
+					 t.center.y + t.tangent.y * t.halfHeight),
+				b(t.center.x - t.tangent.x * t.halfHeight,
+				  t.center.y - t.tangent.y * t.halfHeight);
+			e.min = ImVec2(std::min(a.x, b.x), std::min(a.y, b.y));
+			e.max = ImVec2(std::max(a.x, b.x), std::max(a.y, b.y));
+			e.type = thinLens;
+			e.index = thinLenses.size();
+			thinLenses.push_back(t);
+		}
+		elements.push_back(e);
+	}
+
+	// Rays which hit changed element are traced again, when its shape
+	// changed also rays passing through its old or new bounds, as shape
+	// may change inside same bounds
+	for (size_t i = 0; i < std::max(lens.size(), previous.size()); i++) {
+		bool isNew = i < lens.size(), wasOld = i < previous.size();
+		if (isNew && wasOld && sameGeometry(lens[i], previousLens[i]))
+			continue;
+		if (isNew) changed[i] = 1;
+		if (isNew && wasOld && sameShape(lens[i], previousLens[i])) continue;
+		if (isNew) {
+			changedMin.push_back(elements[i].min);
+			changedMax.push_back(elements[i].max);
+		}
+		if (wasOld) {
+			changedMin.push_back(previous[i].min);
+			changedMax.push_back(previous[i].max);
+		}
+	}
+
+	order.resize(elements.size());
+	for (size_t i = 0; i < order.size(); i++) order[i] = i;
+	nodes.clear();
+	nodes.reserve(2 * elements.size() / leafSize + 1);
+	build(0, elements.size());
+	return true;
+}
+
+// Splits elements at median of their centers along longer side of box
+int Tracer::build(int first, int count) {
+	int id = nodes.size();
+	nodes.push_back(Node());
+	Node node;
+	node.first = first;
+	node.count = count;
+	node.min = ImVec2(std::numeric_limits<float>::infinity(),
+					  std::numeric_limits<float>::infinity());
+	node.max = ImVec2(-node.min.x, -node.min.y);
+	for (int i = first; i < first + count; i++) {
+		const Element& e = elements[order[i]];
+		node.min = ImVec2(std::min(node.min.x, e.min.x),
+						  std::min(node.min.y, e.min.y));
+		node.max = ImVec2(std::max(node.max.x, e.max.x),
+						  std::max(node.max.y, e.max.y));
+	}
+
+	node.alongX = node.max.x - node.min.x > node.max.y - node.min.y;
+	if (count > leafSize) {
+		bool alongX = node.alongX;
+		auto center = [&](int i) {
+			const Element& e = elements[i];
+			return alongX ? e.min.x + e.max.x : e.min.y + e.max.y;
+		};
+		std::nth_element(
+			order.begin() + first, order.begin() + first + count / 2,
+			order.begin() + first + count,
+			[&](int a, int b) { return center(a) < center(b); });
+		node.left = build(first, count / 2);
+		node.right = build(first + count / 2, count - count / 2);
+	} else {
+		std::sort(order.begin() + first, order.begin() + first + count,
+				  [&](int a, int b) {
+					  return elements[a].type < elements[b].type;
+				  });
+	}
+	nodes[id] = node;
+	return id;
+}
+
+bool Tracer::needsTrace(const Ray& ray) const {
+	if (!ray.traced || changedAll) return true;
+	for (int e : ray.hits)
+		if (e >= (int)changed.size() || changed[e]) return true;
+	for (size_t i = 1; i < ray.points.size(); i++)
+		for (size_t c = 0; c < changedMin.size(); c++)
+			if (segmentHitsBox(ray.points[i - 1], ray.points[i], changedMin[c],
+							   changedMax[c]))
+				return true;
+	return false;
+}
+
+void Tracer::trace(Ray& ray) const {
+	ray.points.clear();
+	ray.points.push_back(ray.origin);
+	ray.hits.clear();
+	follow(ray, ray.origin, ray.direction, maxBounces);
+	ray.traced = true;
+}
+
+void Tracer::follow(Ray& ray, ImVec2 origin, ImVec2 direction,
+					int bounces) const {
+	ray.escaped = false;
+	for (int bounce = 0; bounce < bounces; bounce++) {
+		Hit hit;
+		if (!closestHit(origin, direction, hit)) {
+			ray.escaped = true;
+			break;
+		}
+		origin = ImVec2(origin.x + direction.x * hit.distance,
+						origin.y + direction.y * hit.distance);
+		ray.points.push_back(origin);
+		ray.hits.push_back(hit.element);
+		if (elements[hit.element].type == stop) break;
+		direction = redirect(elements[hit.element], origin, direction,
+							 ray.wavelength);
+	}
+	if (ray.escaped)
+		ray.points.push_back(ImVec2(origin.x + direction.x * escapeDistance,
+									origin.y + direction.y * escapeDistance));
+}
+
+void Tracer::tracePacket(Ray* const* rays, int count) const {
+	Packet p;
+	for (int i = 0; i < packetSize; i++) {
+		bool used = i < count;
+		p.ox[i] = used ? rays[i]->origin.x : 0;
+		p.oy[i] = used ? rays[i]->origin.y : 0;
+		p.dx[i] = used ? rays[i]->direction.x : 1;
+		p.dy[i] = used ? rays[i]->direction.y : 0;
+		p.wavelength[i] = used ? rays[i]->wavelength : sodiumWavelength;
+		p.alive[i] = used;
+		if (!used) continue;
+		rays[i]->points.clear();
+		rays[i]->points.push_back(rays[i]->origin);
+		rays[i]->hits.clear();
+		rays[i]->escaped = false;
+		rays[i]->traced = true;
+	}
+
+	int bounce = 0;
+	bool scattered = false;
+	for (; bounce < maxBounces && !scattered; bounce++) {
+		// Wavelengths of one ray share path until glass splits them, till
+		// then one search serves all of them
+		int first = 0;
+		while (first + 1 < count && p.alive[first] == 0) first++;
+		bool same = true;
+		for (int i = first + 1; i < count; i++)
+			same &= p.alive[i] == 0 ||
+					(p.ox[i] == p.ox[first] && p.oy[i] == p.oy[first] &&
+					 p.dx[i] == p.dx[first] && p.dy[i] == p.dy[first]);
+		if (same) {
+			Hit hit = {std::numeric_limits<float>::infinity(), -1};
+			if (!closestHit(ImVec2(p.ox[first], p.oy[first]),
+							ImVec2(p.dx[first], p.dy[first]), hit))
+				hit.element = -1;
+			for (int i = 0; i < packetSize; i++) {
+				p.distance[i] = hit.distance;
+				p.element[i] = hit.element;
+			}
+		} else {
+			closestHits(p);
+		}
+		int alive = 0, distinct = 0;
+		for (int i = 0; i < count; i++) {
+			bool first = p.alive[i] != 0 && p.element[i] != -1;
+			for (int j = 0; j < i && first; j++)
+				first = !(p.alive[j] != 0 && p.element[j] == p.element[i]);
+			distinct += first;
+		}
+		for (int i = 0; i < count; i++) {
+			if (p.alive[i] == 0) continue;
+			if (p.element[i] == -1) {
+				p.alive[i] = 0;
+				rays[i]->escaped = true;
+				continue;
+			}
+			ImVec2 point(p.ox[i] + p.dx[i] * p.distance[i],
+						 p.oy[i] + p.dy[i] * p.distance[i]);
+			rays[i]->points.push_back(point);
+			rays[i]->hits.push_back(p.element[i]);
+			if (elements[p.element[i]].type == stop) {
+				p.alive[i] = 0;
+				continue;
+			}
+			ImVec2 d = redirect(elements[p.element[i]], point,
+								ImVec2(p.dx[i], p.dy[i]), p.wavelength[i]);
+			p.ox[i] = point.x;
+			p.oy[i] = point.y;
+			p.dx[i] = d.x;
+			p.dy[i] = d.y;
+			alive++;
+		}
+		if (alive == 0) break;
+		// Few rays left are faster alone
+		scattered = distinct > packetSize / 2 || alive <= packetSize / 4;
+	}
+	for (int i = 0; i < count; i++) {
+		if (p.alive[i] != 0) {
+			// Continues alone, without bounces left it just stops
+			follow(*rays[i], ImVec2(p.ox[i], p.oy[i]),
+				   ImVec2(p.dx[i], p.dy[i]), maxBounces - bounce);
+		} else if (rays[i]->escaped) {
+			rays[i]->points.push_back(
+				ImVec2(p.ox[i] + p.dx[i] * escapeDistance,
+					   p.oy[i] + p.dy[i] * escapeDistance));
+		}
+	}
+}
+
+template <class T>
+void Tracer::hitRun(const std::vector<T>& items, int first, int last,
+					const ImVec2& origin, const ImVec2& direction,
+					Hit& hit) const {
+	for (int i = first; i < last; i++) {
+		float distance;
+		if (intersect(items[elements[order[i]].index], origin, direction,
+					  distance) &&
+			distance < hit.distance) {
+			hit.distance = distance;
+			hit.element = order[i];
+		}
+	}
+}
+
+template <class T>
+void Tracer::intersectRun(const std::vector<T>& items, int first, int last,
+						  Packet& p) const {
+	for (int i = first; i < last; i++)
+		intersectPacket(items[elements[order[i]].index], order[i], p);
+}
+
+// Packet walks tree together, node is visited when any live ray can hit
+// something in it closer than its current hit
+void Tracer::closestHits(Packet& p) const {
+	for (int i = 0; i < packetSize; i++) {
+		p.ix[i] = 1 / p.dx[i];
+		p.iy[i] = 1 / p.dy[i];
+		p.distance[i] = std::numeric_limits<float>::infinity();
+		p.element[i] = -1;
+	}
+	if (nodes.empty()) return;
+
+	// Rays of packet mostly go one way, so it decides order of children
+	float sumX = 0, sumY = 0;
+	for (int i = 0; i < packetSize; i++) {
+		sumX += p.alive[i] * p.dx[i];
+		sumY += p.alive[i] * p.dy[i];
+	}
+	int stack[64], top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const Node& n = nodes[stack[--top]];
+		if (!packetHitsBox(p, n.min, n.max)) continue;
+		if (n.left == -1) {
+			for (int i = n.first, end = n.first + n.count; i < end;) {
+				Type type = elements[order[i]].type;
+				int last = i + 1;
+				while (last < end && elements[order[last]].type == type)
+					last++;
+				switch (type) {
+					case thinLens:
+						intersectRun(thinLenses, i, last, p);
+						break;
+					case arcMirror:
+						intersectRun(arcMirrors, i, last, p);
+						break;
+					case thickLens:
+						intersectRun(thickLenses, i, last, p);
+						break;
+					case prism:
+						intersectRun(prisms, i, last, p);
+						break;
+					case flatMirror:
+						intersectRun(flatMirrors, i, last, p);
+						break;
+					case stop:
+						intersectRun(stops, i, last, p);
+						break;
+				}
+				i = last;
+			}
+			continue;
+		}
+		if ((n.alongX ? sumX : sumY) < 0) {
+			stack[top++] = n.left;
+			stack[top++] = n.right;
+		} else {
+			stack[top++] = n.right;
+			stack[top++] = n.left;
+		}
+	}
+}
+
+bool Tracer::packetHitsBox(const Packet& p, const ImVec2& min,
+						   const ImVec2& max) const {
+	int hits = 0;
+	for (int i = 0; i < packetSize; i++) {
+		float t1 = (min.x - p.ox[i]) * p.ix[i],
+			  t2 = (max.x - p.ox[i]) * p.ix[i];
+		float enter = std::min(t1, t2), exit = std::max(t1, t2);
+		t1 = (min.y - p.oy[i]) * p.iy[i];
+		t2 = (max.y - p.oy[i]) * p.iy[i];
+		enter = std::max(std::max(enter, std::min(t1, t2)), 0.0f);
+		exit = std::min(exit, std::max(t1, t2));
+		hits += p.alive[i] != 0 && enter <= exit && enter < p.distance[i];
+	}
+	return hits > 0;
+}
+
+void Tracer::intersectPacket(const ThinLens& l, int element,
+							 Packet& p) const {
+	for (int i = 0; i < packetSize; i++) {
+		float denominator = p.dx[i] * l.tangent.y - p.dy[i] * l.tangent.x;
+		float cx = l.center.x - p.ox[i], cy = l.center.y - p.oy[i];
+		float inverse = 1 / denominator;
+		float t = (cx * l.tangent.y - cy * l.tangent.x) * inverse,
+			  h = (cx * p.dy[i] - cy * p.dx[i]) * inverse;
+		bool hit = p.alive[i] != 0 && denominator != 0 && t > minDistance &&
+				   std::fabs(h) <= l.halfHeight && t < p.distance[i];
+		p.distance[i] = hit ? t : p.distance[i];
+		p.element[i] = hit ? element : p.element[i];
+	}
+}
+
+void Tracer::intersectPacket(const ArcMirror& m, int element,
+							 Packet& p) const {
+	for (int i = 0; i < packetSize; i++) {
+		float fx = p.ox[i] - m.center.x, fy = p.oy[i] - m.center.y;
+		float b = fx * p.dx[i] + fy * p.dy[i],
+			  c = fx * fx + fy * fy - m.radius * m.radius;
+		float delta = b * b - c;
+		float root = std::sqrt(std::max(delta, 0.0f));
+
+		// Both crossings are checked against arc without branches
+		float t1 = -b - root, t2 = -b + root;
+		float v1x = fx + p.dx[i] * t1, v1y = fy + p.dy[i] * t1,
+			  v2x = fx + p.dx[i] * t2, v2y = fy + p.dy[i] * t2;
+		bool narrow1 = m.start.x * v1y - m.start.y * v1x >= 0 &&
+					   v1x * m.end.y - v1y * m.end.x >= 0,
+			 gap1 = m.end.x * v1y - m.end.y * v1x > 0 &&
+					v1x * m.start.y - v1y * m.start.x > 0;
+		bool narrow2 = m.start.x * v2y - m.start.y * v2x >= 0 &&
+					   v2x * m.end.y - v2y * m.end.x >= 0,
+			 gap2 = m.end.x * v2y - m.end.y * v2x > 0 &&
+					v2x * m.start.y - v2y * m.start.x > 0;
+		bool on1 = m.wide ? !gap1 : narrow1, on2 = m.wide ? !gap2 : narrow2;
+		bool valid1 = on1 && t1 > minDistance, valid2 = on2 && t2 > minDistance;
+		float t = valid1 ? t1 : t2;
+		bool hit = p.alive[i] != 0 && delta >= 0 && (valid1 || valid2) &&
+				   t < p.distance[i];
+		p.distance[i] = hit ? t : p.distance[i];
+		p.element[i] = hit ? element : p.element[i];
+	}
+}
+
+void Tracer::intersectPacket(const ThickLens& l, int element,
+							 Packet& p) const {
+	float radius2 = l.radius * l.radius;
+	for (float side : {1.0f, -1.0f}) {
+		ImVec2 center(l.center.x + l.axis.x * l.offset * side,
+					  l.center.y + l.axis.y * l.offset * side),
+			other(l.center.x - l.axis.x * l.offset * side,
+				  l.center.y - l.axis.y * l.offset * side);
+		for (int i = 0; i < packetSize; i++) {
+			float fx = p.ox[i] - center.x, fy = p.oy[i] - center.y;
+			float b = fx * p.dx[i] + fy * p.dy[i],
+				  c = fx * fx + fy * fy - radius2;
+			float delta = b * b - c;
+			float root = std::sqrt(std::max(delta, 0.0f));
+
+			// Crossing is on surface when it lies in circle of other one
+			float t1 = -b - root, t2 = -b + root;
+			float v1x = p.ox[i] + p.dx[i] * t1 - other.x,
+				  v1y = p.oy[i] + p.dy[i] * t1 - other.y,
+				  v2x = p.ox[i] + p.dx[i] * t2 - other.x,
+				  v2y = p.oy[i] + p.dy[i] * t2 - other.y;
+			bool valid1 = v1x * v1x + v1y * v1y <= radius2 && t1 > minDistance,
+				 valid2 = v2x * v2x + v2y * v2y <= radius2 && t2 > minDistance;
+			float t = valid1 ? t1 : t2;
+			bool hit = p.alive[i] != 0 && delta >= 0 && (valid1 || valid2) &&
+					   t < p.distance[i];
+			p.distance[i] = hit ? t : p.distance[i];
+			p.element[i] = hit ? element : p.element[i];
+		}
+	}
+}
+
+void Tracer::intersectPacket(const Prism& m, int element, Packet& p) const {
+	for (int j = 0; j < 3; j++) {
+		const ImVec2& a = m.vertex[j];
+		ImVec2 edge(m.vertex[(j + 1) % 3].x - a.x,
+					m.vertex[(j + 1) % 3].y - a.y);
+		for (int i = 0; i < packetSize; i++) {
+			float denominator = p.dx[i] * edge.y - p.dy[i] * edge.x;
+			float ax = a.x - p.ox[i], ay = a.y - p.oy[i];
+			float inverse = 1 / denominator;
+			float t = (ax * edge.y - ay * edge.x) * inverse,
+				  s = (ax * p.dy[i] - ay * p.dx[i]) * inverse;
+			bool hit = p.alive[i] != 0 && denominator != 0 &&
+					   t > minDistance && s >= 0 && s <= 1 &&
+					   t < p.distance[i];
+			p.distance[i] = hit ? t : p.distance[i];
+			p.element[i] = hit ? element : p.element[i];
+		}
+	}
+}
+
+void Tracer::intersectPacket(const FlatMirror& m, int element,
+							 Packet& p) const {
+	for (int i = 0; i < packetSize; i++) {
+		float denominator = p.dx[i] * m.tangent.y - p.dy[i] * m.tangent.x;
+		float cx = m.center.x - p.ox[i], cy = m.center.y - p.oy[i];
+		float inverse = 1 / denominator;
+		float t = (cx * m.tangent.y - cy * m.tangent.x) * inverse,
+			  h = (cx * p.dy[i] - cy * p.dx[i]) * inverse;
+		bool hit = p.alive[i] != 0 && denominator != 0 && t > minDistance &&
+				   std::fabs(h) <= m.halfHeight && t < p.distance[i];
+		p.distance[i] = hit ? t : p.distance[i];
+		p.element[i] = hit ? element : p.element[i];
+	}
+}
+
+void Tracer::intersectPacket(const Stop& s, int element, Packet& p) const {
+	for (int i = 0; i < packetSize; i++) {
+		float denominator = p.dx[i] * s.tangent.y - p.dy[i] * s.tangent.x;
+		float cx = s.center.x - p.ox[i], cy = s.center.y - p.oy[i];
+		float inverse = 1 / denominator;
+		float t = (cx * s.tangent.y - cy * s.tangent.x) * inverse,
+			  h = std::fabs((cx * p.dy[i] - cy * p.dx[i]) * inverse);
+		bool hit = p.alive[i] != 0 && denominator != 0 && t > minDistance &&
+				   h <= s.outer && h >= s.inner && t < p.distance[i];
+		p.distance[i] = hit ? t : p.distance[i];
+		p.element[i] = hit ? element : p.element[i];
+	}
+}
+
+bool Tracer::closestHit(const ImVec2& origin, const ImVec2& direction,
+						Hit& hit) const {
+	if (nodes.empty()) return false;
+	ImVec2 inverse(1 / direction.x, 1 / direction.y);
+	hit.distance = std::numeric_limits<float>::infinity();
+	hit.element = -1;
+
+	int stack[64], top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const Node& n = nodes[stack[--top]];
+		if (boxDistance(n.min, n.max, origin, inverse) >= hit.distance)
+			continue;
+		if (n.left == -1) {
+			for (int i = n.first, end = n.first + n.count; i < end;) {
+				Type type = elements[order[i]].type;
+				int last = i + 1;
+				while (last < end && elements[order[last]].type == type)
+					last++;
+				switch (type) {
+					case thinLens:
+						hitRun(thinLenses, i, last, origin, direction, hit);
+						break;
+					case arcMirror:
+						hitRun(arcMirrors, i, last, origin, direction, hit);
+						break;
+					case thickLens:
+						hitRun(thickLenses, i, last, origin, direction, hit);
+						break;
+					case prism:
+						hitRun(prisms, i, last, origin, direction, hit);
+						break;
+					case flatMirror:
+						hitRun(flatMirrors, i, last, origin, direction, hit);
+						break;
+					case stop:
+						hitRun(stops, i, last, origin, direction, hit);
+						break;
+				}
+				i = last;
+			}
+			continue;
+		}
+		// Nearer child is visited first
+		float left = boxDistance(nodes[n.left].min, nodes[n.left].max, origin,
+								 inverse),
+			  right = boxDistance(nodes[n.right].min, nodes[n.right].max,
+								  origin, inverse);
+		if (left < right) {
+			stack[top++] = n.right;
+			stack[top++] = n.left;
+		} else {
+			stack[top++] = n.left;
+			stack[top++] = n.right;
+		}
+	}
+	return hit.element != -1;
+}
+
+ImVec2 Tracer::redirect(const Element& e, const ImVec2& point,
+						const ImVec2& direction, float wavelength) const {
+	switch (e.type) {
+		case thinLens: {
+			// Slope against lens axis drops by height / focus
+			const ThinLens& l = thinLenses[e.index];
+			ImVec2 axis(-l.tangent.y, l.tangent.x);
+			float along = dot(direction, axis);
+			if (along < 0) {
+				axis = ImVec2(-axis.x, -axis.y);
+				along = -along;
+			}
+			float h = dot(ImVec2(point.x - l.center.x, point.y - l.center.y),
+						  l.tangent);
+			float slope = dot(direction, l.tangent) / along - h / l.focus;
+			float length = std::sqrt(1 + slope * slope);
+			return ImVec2((axis.x + l.tangent.x * slope) / length,
+						  (axis.y + l.tangent.y * slope) / length);
+		}
+		case arcMirror: {
+			// Mirror reflection about radius. Rounding errors grow with
+			// every bounce, so both vectors are normalized again.
+			const ArcMirror& m = arcMirrors[e.index];
+			ImVec2 normal(point.x - m.center.x, point.y - m.center.y);
+			float length = std::sqrt(dot(normal, normal));
+			normal = ImVec2(normal.x / length, normal.y / length);
+			float d = 2 * dot(direction, normal);
+			ImVec2 reflected(direction.x - normal.x * d,
+							 direction.y - normal.y * d);
+			length = std::sqrt(dot(reflected, reflected));
+			return ImVec2(reflected.x / length, reflected.y / length);
+		}
+		case thickLens: {
+			// Point lies on surface which circle passes closer to it
+			const ThickLens& l = thickLenses[e.index];
+			ImVec2 normal;
+			float error = std::numeric_limits<float>::infinity();
+			for (float side : {1.0f, -1.0f}) {
+				ImVec2 v(point.x - l.center.x - l.axis.x * l.offset * side,
+						 point.y - l.center.y - l.axis.y * l.offset * side);
+				float length = std::sqrt(dot(v, v));
+				if (std::fabs(length - l.radius) < error) {
+					error = std::fabs(length - l.radius);
+					normal = ImVec2(v.x / length, v.y / length);
+				}
+			}
+			return refract(direction, normal,
+						   cauchy(l.cauchyA, l.cauchyB, wavelength));
+		}
+		case prism: {
+			// Point lies on side which line passes closer to it
+			const Prism& m = prisms[e.index];
+			int side = 0;
+			float error = std::numeric_limits<float>::infinity();
+			for (int j = 0; j < 3; j++) {
+				float d = std::fabs(dot(ImVec2(point.x - m.vertex[j].x,
+											   point.y - m.vertex[j].y),
+										m.normal[j]));
+				if (d < error) {
+					error = d;
+					side = j;
+				}
+			}
+			return refract(direction, m.normal[side],
+						   cauchy(m.cauchyA, m.cauchyB, wavelength));
+		}
+		case flatMirror: {
+			const FlatMirror& m = flatMirrors[e.index];
+			ImVec2 normal(-m.tangent.y, m.tangent.x);
+			float d = 2 * dot(direction, normal);
+			return ImVec2(direction.x - normal.x * d,
+						  direction.y - normal.y * d);
+		}
+		case stop:
+			break;	// Ray ends on it
+	}
+	return direction;
+}
+
+void Tracer::outline(int element, std::vector<ImVec2>& points) const {
+	points.clear();
+	const Element& e = elements[element];
+	if (e.type == prism) {
+		for (const ImVec2& v : prisms[e.index].vertex) points.push_back(v);
+	} else if (e.type == thickLens) {
+		// Each surface spans same angle on both sides of axis
+		const ThickLens& l = thickLenses[e.index];
+		float spread = std::acos(std::min(l.offset / l.radius, 1.0f));
+		const int steps = 16;
+		for (float side : {1.0f, -1.0f}) {
+			ImVec2 center(l.center.x + l.axis.x * l.offset * side,
+						  l.center.y + l.axis.y * l.offset * side);
+			float facing = std::atan2(-l.axis.y * side, -l.axis.x * side);
+			for (int k = 0; k <= steps; k++) {
+				float a = facing - spread + 2 * spread * k / steps;
+				points.push_back(ImVec2(center.x + l.radius * std::cos(a),
+										center.y + l.radius * std::sin(a)));
+			}
+		}
+	}
+}
@@ -0,0 +1,156 @@
+#ifndef OPTICS_TRACE_H
+#define OPTICS_TRACE_H
+
+#include <imgui.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "optics.hpp"
+
+namespace Optic {
+// Thin lens as segment, focus is negative for diverging lens
+struct ThinLens {
+	ImVec2 center, tangent;	 // Tangent is unit vector along lens
+	float halfHeight, focus;
+};
+
+// Mirror on arc of circle going counterclockwise from start to end
+struct ArcMirror {
+	ImVec2 center;
+	float radius;
+	ImVec2 start, end;	// Unit vectors from center to arc ends
+	bool wide;			// Arc is longer than half of circle
+};
+
+// Glass between two arcs of same radius meeting at rim of lens
+struct ThickLens {
+	ImVec2 center, axis;  // Axis is unit vector across lens
+	float radius;		  // Of both surfaces
+	float offset;  // From center of lens to centers of surface circles
+	float cauchyA, cauchyB;
+};
+
+// Glass triangle
+struct Prism {
+	ImVec2 vertex[3];
+	ImVec2 normal[3];  // Outward unit normal of side from vertex i to i + 1
+	float cauchyA, cauchyB;
+};
+
+// Flat mirror as segment, both its sides reflect
+struct FlatMirror {
+	ImVec2 center, tangent;	 // Tangent is unit vector along mirror
+	float halfHeight;
+};
+
+// Opaque segment which ends rays, aperture has hole in its middle
+struct Stop {
+	ImVec2 center, tangent;	 // Tangent is unit vector along stop
+	float inner, outer;		 // Half widths of hole and of whole stop
+};
+
+// Traces rays through lenses, mirrors and glass. Elements are kept in bounding
+// volume hierarchy, so a ray tests only elements near its path. Elements of
+// each type lie in own array and leaves of hierarchy are sorted by type, so
+// every run of one type is tested in a loop of its own.
+class Tracer {
+   public:
+	int maxBounces = 64;		   // Per ray
+	float escapeDistance = 10.0f;  // Length of last segment of ray, in m
+
+	// Index is rebuilt only when elements differ from previous call.
+	// Returns true when it was rebuilt.
+	bool setElements(const std::vector<Lens>& lens);
+	// Ray was never traced or its path meets element changed by last
+	// setElements call, either its old or new place
+	bool needsTrace(const Ray& ray) const;
+	// Grows with every change of elements or limits of rays
+	unsigned revision() const { return changes; }
+	// Fills path of ray, every ray has own limit of bounces
+	void trace(Ray& ray) const;
+
+	static const int packetSize = 8;
+	// Traces up to packetSize rays together. Loops over rays of packet have
+	// no branches, so compiler can turn them into vector instructions. Once
+	// rays scatter to different elements they are finished one by one.
+	void tracePacket(Ray* const* rays, int count) const;
+	// Border of glass element as closed polygon, empty for other elements
+	void outline(int element, std::vector<ImVec2>& points) const;
+
+   private:
+	enum Type { thinLens, arcMirror, thickLens, prism, flatMirror, stop };
+	struct Element {
+		Type type;
+		int index;	// In array of its type
+		ImVec2 min, max;
+	};
+	struct Node {
+		ImVec2 min, max;
+		int left = -1, right = -1;	// Children, -1 in leaf
+		int first, count;			// Range in order
+		bool alongX;				// Children split by x, else by y
+	};
+	struct Hit {
+		float distance;
+		int element;
+	};
+	static const int leafSize = 4;
+	// Rays of packet as separate arrays of coordinates
+	struct Packet {
+		alignas(32) float ox[packetSize], oy[packetSize];
+		alignas(32) float dx[packetSize], dy[packetSize];
+		alignas(32) float ix[packetSize], iy[packetSize];  // 1 / d
+		alignas(32) float wavelength[packetSize];
+		alignas(32) float distance[packetSize];			   // Closest hit
+		alignas(32) int element[packetSize];
+		alignas(32) float alive[packetSize];  // 0 for finished rays
+	};
+
+	std::vector<Lens> lastLens;
+	int lastBounces = 0;
+	float lastEscape = 0;
+	// Changes made by last setElements call
+	bool changedAll = true;
+	unsigned changes = 0;
+	std::vector<uint8_t> changed;		   // Per element
+	std::vector<ImVec2> changedMin, changedMax;  // Old and new bounds
+	std::vector<ThinLens> thinLenses;
+	std::vector<ArcMirror> arcMirrors;
+	std::vector<ThickLens> thickLenses;
+	std::vector<Prism> prisms;
+	std::vector<FlatMirror> flatMirrors;
+	std::vector<Stop> stops;
+	std::vector<Element> elements;
+	std::vector<int> order;	 // Elements sorted by nodes
+	std::vector<Node> nodes;
+
+	int build(int first, int count);
+	// Continues ray for at most bounces hits, escaped ray gets last
+	// segment of escapeDistance
+	void follow(Ray& ray, ImVec2 origin, ImVec2 direction,
+				int bounces) const;
+	bool closestHit(const ImVec2& origin, const ImVec2& direction,
+					Hit& hit) const;
+	// Tests elements order[first .. last), which are all of one type
+	template <class T>
+	void hitRun(const std::vector<T>& items, int first, int last,
+				const ImVec2& origin, const ImVec2& direction, Hit& hit) const;
+	ImVec2 redirect(const Element& e, const ImVec2& point,
+					const ImVec2& direction, float wavelength) const;
+	void closestHits(Packet& p) const;
+	template <class T>
+	void intersectRun(const std::vector<T>& items, int first, int last,
+					  Packet& p) const;
+	bool packetHitsBox(const Packet& p, const ImVec2& min,
+					   const ImVec2& max) const;
+	void intersectPacket(const ThinLens& l, int element, Packet& p) const;
+	void intersectPacket(const ArcMirror& m, int element, Packet& p) const;
+	void intersectPacket(const ThickLens& l, int element, Packet& p) const;
+	void intersectPacket(const Prism& m, int element, Packet& p) const;
+	void intersectPacket(const FlatMirror& m, int element, Packet& p) const;
+	void intersectPacket(const Stop& s, int element, Packet& p) const;
+};
+}  // namespace Optic
+
+#endif
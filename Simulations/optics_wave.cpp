@@ -0,0 +1,155 @@
+#include "optics_wave.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+#include "../parallel.hpp"
+
+using namespace Optic;
+
+void Wave::update(const ImVec2& size) {
+	int w = std::max((int)(size.x / pixelStep), 1),
+		h = std::max((int)(size.y / pixelStep), 1);
+	Bench bench = {wavelength, fieldWidth, length, elements};
+	bool changed = !(bench == last);
+	if (changed) {
+		last = bench;
+		propagate();
+	}
+	if (changed || w != width || h != height || pixelStep != evaluatedStep) {
+		width = w;
+		height = h;
+		evaluatedStep = pixelStep;
+		intensity.assign(width * height, 0.0f);
+		// Every column is plane across axis, found by one inverse transform
+		parallelFor(width, [&](size_t begin, size_t end) {
+			std::vector<std::complex<float>> field(samples);
+			for (size_t column = begin; column < end; column++) {
+				float z = (column + 0.5f) / width * length;
+				auto s = std::upper_bound(
+							 segments.begin(), segments.end(), z,
+							 [](float z, const Segment& s) {
+								 return z < s.start;
+							 }) -
+						 1;
+				fieldAt(*s, z - s->start, field.data());
+				// Row takes mean of samples it covers
+				for (int row = 0; row < height; row++) {
+					int first = (long)row * samples / height,
+						last = std::max((long)(row + 1) * samples / height,
+										(long)first + 1);
+					float sum = 0;
+					for (int i = first; i < last; i++)
+						sum += std::norm(field[i]);
+					intensity[row * width + column] = sum / (last - first);
+				}
+			}
+		});
+		mappedExposure = 0.0f;
+	}
+	if (exposure != mappedExposure || texture.empty()) toneMap();
+}
+
+void Wave::draw(ImDrawList* drawList, const ImVec2& origin) const {
+	if (texture.empty()) return;
+	drawList->AddImage(texture.id(), origin,
+					   ImVec2(origin.x + width * evaluatedStep,
+							  origin.y + height * evaluatedStep));
+}
+
+// Plane wave of field is carried from element to element. Spectrum after
+// each of them is kept, so any plane behind it takes one transform.
+void Wave::propagate() {
+	fft.plan(samples);
+	double k = 2 * M_PI / (wavelength * 1e-9), step = fieldWidth / samples;
+	phase.resize(samples);
+	decay.resize(samples);
+	for (int i = 0; i < samples; i++) {
+		// Frequencies above half of samples are negative ones
+		double kx = 2 * M_PI * (i < samples / 2 ? i : i - samples) / fieldWidth,
+			   kz2 = k * k - kx * kx;
+		phase[i] = kz2 >= 0 ? -kx * kx / (k + std::sqrt(kz2)) : -k;
+		decay[i] = kz2 >= 0 ? 0.0f : std::sqrt(-kz2);
+	}
+
+	std::vector<WaveElement> sorted = elements;
+	std::stable_sort(sorted.begin(), sorted.end(),
+					 [](const WaveElement& a, const WaveElement& b) {
+						 return a.position < b.position;
+					 });
+	std::vector<std::complex<float>> field(samples, 1.0f);
+	segments.assign(1, Segment{0.0f, field});
+	fft.forward(segments[0].spectrum.data());
+	for (auto& e : sorted) {
+		if (e.position < 0 || e.position > length) continue;
+		const Segment& s = segments.back();
+		fieldAt(s, e.position - s.start, field.data());
+		for (int i = 0; i < samples; i++) {
+			double y = (i + 0.5 - samples / 2) * step;
+			if (e.type == WaveElement::Type::lens) {
+				// Thin lens delays wave by k y² / 2f
+				double a = -k * y * y / (2 * e.focus);
+				field[i] *= std::complex<float>(std::cos(a), std::sin(a));
+				continue;
+			}
+			// Sample lets through part of its cell lying in slits
+			float open = 0;
+			for (int j = 0; j < e.count; j++) {
+				double center = (j - (e.count - 1) / 2.0) * e.separation;
+				double from = std::max(y - step / 2, center - e.width / 2),
+					   to = std::min(y + step / 2, center + e.width / 2);
+				open += std::max(to - from, 0.0) / step;
+			}
+			field[i] *= std::min(open, 1.0f);
+		}
+		segments.push_back(Segment{e.position, field});
+		fft.forward(segments.back().spectrum.data());
+	}
+
+	const Segment& s = segments.back();
+	fieldAt(s, length - s.start, field.data());
+	endIntensity.resize(samples);
+	for (int i = 0; i < samples; i++) endIntensity[i] = std::norm(field[i]);
+}
+
+// Plane waves steeper than field width allows over distance would come
+// back from other side, so they are left out (band limited angular
+// spectrum method)
+void Wave::fieldAt(const Segment& s, float distance,
+				   std::complex<float>* field) const {
+	double ratio = 2 * distance / fieldWidth,
+		   limit = fieldWidth / (wavelength * 1e-9 *
+								 std::sqrt(ratio * ratio + 1));
+	for (int i = 0; i < samples; i++) {
+		if (std::abs(i < samples / 2 ? i : i - samples) > limit) {
+			field[i] = 0;
+			continue;
+		}
+		double a = phase[i] * distance;
+		float amplitude = decay[i] > 0 ? std::exp(-decay[i] * distance) : 1,
+			  c = std::cos(a) * amplitude, d = std::sin(a) * amplitude;
+		const std::complex<float>& v = s.spectrum[i];
+		field[i] = std::complex<float>(v.real() * c - v.imag() * d,
+									   v.real() * d + v.imag() * c);
+	}
+	fft.inverse(field);
+}
+
+// Color of wavelength with Reinhard curve and gamma of 2
+void Wave::toneMap() {
+	ImVec4 color = spectrumColor(wavelength);
+	pixels.resize(width * height);
+	for (size_t i = 0; i < pixels.size(); i++) {
+		float v = intensity[i] * exposure, b = std::sqrt(v / (1 + v));
+		pixels[i] = 0xff000000 | (uint32_t)(color.x * b * 255 + 0.5f) << 16 |
+					(uint32_t)(color.y * b * 255 + 0.5f) << 8 |
+					(uint32_t)(color.z * b * 255 + 0.5f);
+	}
+	mappedExposure = exposure;
+	texture.upload(pixels.data(), width, height);
+}
@@ -0,0 +1,90 @@
+#ifndef OPTICS_WAVE_H
+#define OPTICS_WAVE_H
+
+#include <imgui.h>
+
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+#include "../fft.hpp"
+#include "../texture.hpp"
+#include "optics.hpp"
+
+namespace Optic {
+// Screen across axis of wave bench
+struct WaveElement {
+	enum Type { slits, lens };
+	Type type = slits;
+	float position = 0.02f;		 // Along axis, in m
+	int count = 2;				 // Of slits
+	float width = 2e-5f;		 // Of slit, in m
+	float separation = 2e-4f;	 // Between centers of slits, in m
+	float focus = 0.2f;			 // Of lens, in m
+	bool operator==(const WaveElement& e) const {
+		return type == e.type && position == e.position && count == e.count &&
+			   width == e.width && separation == e.separation &&
+			   focus == e.focus;
+	}
+};
+
+// Scalar wave of one wavelength coming as plane wave along axis through
+// slits and thin lenses. Field across axis is sampled at fixed points and
+// carried between planes by angular spectrum method, every plane wave of
+// its spectrum gets phase of its own over the distance. Field is periodic
+// across its width, light reaching its edge comes back on other side.
+class Wave {
+   public:
+	static const int samples = 2048;	  // Across field
+	float wavelength = sodiumWavelength;  // In nm
+	float fieldWidth = 1e-2f;			  // Across axis, in m
+	float length = 0.3f;				  // Along axis, in m
+	float exposure = 10.0f;				  // Plane wave has intensity 1
+	int pixelStep = 2;					  // Screen pixels per cell
+	std::vector<WaveElement> elements = {WaveElement()};
+
+	// Field is propagated again only when bench or size changes. Axis goes
+	// to the right across whole size.
+	void update(const ImVec2& size);
+	void draw(ImDrawList* drawList, const ImVec2& origin) const;
+	// Intensity at samples across end of bench
+	const std::vector<float>& profile() const { return endIntensity; }
+
+   private:
+	// Field between element and next one as its spectrum
+	struct Segment {
+		float start;
+		std::vector<std::complex<float>> spectrum;
+	};
+	struct Bench {
+		float wavelength, fieldWidth, length;
+		std::vector<WaveElement> elements;
+		bool operator==(const Bench& b) const {
+			return wavelength == b.wavelength && fieldWidth == b.fieldWidth &&
+				   length == b.length && elements == b.elements;
+		}
+	};
+
+	Fft fft;
+	Bench last = {0.0f, 0.0f, 0.0f, {}};
+	int width = 0, height = 0, evaluatedStep = 0;
+	float mappedExposure = 0.0f;
+	// Phase over meter of each plane wave of spectrum, beyond that of
+	// wave along axis, and decay of evanescent ones
+	std::vector<double> phase;
+	std::vector<float> decay;
+	std::vector<Segment> segments;
+	std::vector<float> intensity;  // Per cell, rows across axis
+	std::vector<float> endIntensity;
+	std::vector<uint32_t> pixels;
+	Texture texture;
+
+	void propagate();
+	// Field at distance from start of segment
+	void fieldAt(const Segment& s, float distance,
+				 std::complex<float>* field) const;
+	void toneMap();
+};
+}  // namespace Optic
+
+#endif
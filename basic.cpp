@@ -2,9 +2,12 @@
 
 #include <imgui.h>
 
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
+#include "parallel.hpp"
+
 float distanceBetweenPoints(const ImVec2& from, const ImVec2& to) {
 	return std::sqrt(std::pow(from.x - to.x, 2) + std::pow(from.y - to.y, 2));
 }
@@ -61,6 +64,75 @@ void drawNeedle(const ImVec2& point, ImDrawList* drawList, float length,
 			  40.0f, 1.0f, color);
 }
 
+void drawNeedles(ImDrawList* drawList, size_t count, const ImVec2* points,
+				 const ImVec2* directions, const ImU32* colors,
+				 const float* lengths, float arrowLength, float arrowAngle,
+				 float thickness) {
+	// Every needle is quad of shaft and triangle of head, 7 vertices
+	const int vertices = 7, indices = 9;
+	static const ImDrawIdx pattern[indices] = {0, 1, 2, 0, 2, 3, 4, 5, 6};
+	float headAngle = (arrowAngle / 180) * M_PI / 2;
+	float headCos = std::cos(headAngle), headSin = std::sin(headAngle);
+	ImVec2 uv = drawList->_Data->TexUvWhitePixel;
+
+	// Needles with zero (or too small to square) direction get no place in
+	// buffers
+	static std::vector<size_t> drawn;
+	drawn.clear();
+	for (size_t i = 0; i < count; i++) {
+		const ImVec2& d = directions[i];
+		if (d.x * d.x + d.y * d.y > 0) drawn.push_back(i);
+	}
+	size_t shown = drawn.size();
+
+	drawList->PrimReserve(shown * indices, shown * vertices);
+	ImDrawVert* vtx = drawList->_VtxWritePtr;
+	ImDrawIdx* idx = drawList->_IdxWritePtr;
+	unsigned int base = drawList->_VtxCurrentIdx;
+
+	parallelFor(
+		shown,
+		[&](size_t begin, size_t end) {
+			for (size_t j = begin; j < end; j++) {
+				size_t i = drawn[j];
+				ImDrawVert* v = vtx + j * vertices;
+				ImDrawIdx* n = idx + j * indices;
+				ImDrawIdx first = base + j * vertices;
+				for (int t = 0; t < indices; t++) n[t] = first + pattern[t];
+
+				const ImVec2& d = directions[i];
+				float scale = 1 / std::sqrt(d.x * d.x + d.y * d.y);
+				float ux = d.x * scale, uy = d.y * scale;
+				float half = lengths[i] / 2,
+					  head = std::min(arrowLength, lengths[i] / 2);
+				float wx = -uy * thickness / 2, wy = ux * thickness / 2;
+				ImVec2 tail(points[i].x - ux * half, points[i].y - uy * half),
+					tip(points[i].x + ux * half, points[i].y + uy * half),
+					neck(tip.x - ux * head * headCos,
+						 tip.y - uy * head * headCos);
+				float sx = -uy * head * headSin, sy = ux * head * headSin;
+
+				ImVec2 pos[vertices] = {{tail.x + wx, tail.y + wy},
+										{neck.x + wx, neck.y + wy},
+										{neck.x - wx, neck.y - wy},
+										{tail.x - wx, tail.y - wy},
+										tip,
+										{neck.x + sx, neck.y + sy},
+										{neck.x - sx, neck.y - sy}};
+				for (int t = 0; t < vertices; t++) {
+					v[t].pos = pos[t];
+					v[t].uv = uv;
+					v[t].col = colors[i];
+				}
+			}
+		},
+		256);
+
+	drawList->_VtxWritePtr += shown * vertices;
+	drawList->_IdxWritePtr += shown * indices;
+	drawList->_VtxCurrentIdx += shown * vertices;
+}
+
 Force resultantOfForces(const std::vector<Force>& forces) {
 	double x = 0, y = 0;
 
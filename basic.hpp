@@ -12,6 +12,12 @@ void drawArrow(const ImVec2& start, const ImVec2& end, ImDrawList* drawList,
 			   float thickness = 3.0f, ImColor color = ImColor(255, 255, 255));
 void drawNeedle(const ImVec2& point, ImDrawList* drawList, float length,
 				float angle, ImColor color = ImColor(0, 0, 255));
+// Batched drawNeedle. Needles are centered at points and point along
+// directions, which don't need to be normalized. Zero directions are skipped.
+void drawNeedles(ImDrawList* drawList, size_t count, const ImVec2* points,
+				 const ImVec2* directions, const ImU32* colors,
+				 const float* lengths, float arrowLength = 10.0f,
+				 float arrowAngle = 40.0f, float thickness = 1.0f);
 
 struct Force {
 	double power = 0;
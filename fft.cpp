@@ -0,0 +1,55 @@
+#include "fft.hpp"
+
+#include <cmath>
+#include <complex>
+#include <utility>
+#include <vector>
+
+void Fft::plan(int size) {
+	if (size == n) return;
+	n = size;
+	int bits = 0;
+	while ((1 << bits) < n) bits++;
+	reversed.resize(n);
+	for (int i = 0; i < n; i++) {
+		int r = 0;
+		for (int b = 0; b < bits; b++) r |= ((i >> b) & 1) << (bits - 1 - b);
+		reversed[i] = r;
+	}
+	// Computed in double, so error doesn't grow with size
+	twiddles.resize(n / 2);
+	for (int k = 0; k < n / 2; k++) {
+		double a = -2 * M_PI * k / n;
+		twiddles[k] = std::complex<float>(std::cos(a), std::sin(a));
+	}
+}
+
+void Fft::forward(std::complex<float>* data) const { transform(data, false); }
+
+void Fft::inverse(std::complex<float>* data) const {
+	transform(data, true);
+	float scale = 1.0f / n;
+	for (int i = 0; i < n; i++) data[i] *= scale;
+}
+
+// Butterflies multiply by hand, as complex operator handles infinities
+// through slow library call
+void Fft::transform(std::complex<float>* data, bool inverse) const {
+	for (int i = 0; i < n; i++)
+		if (i < reversed[i]) std::swap(data[i], data[reversed[i]]);
+	float sign = inverse ? -1.0f : 1.0f;
+	for (int length = 2; length <= n; length <<= 1) {
+		int half = length / 2, step = n / length;
+		for (int i = 0; i < n; i += length) {
+			for (int j = 0; j < half; j++) {
+				const std::complex<float>& w = twiddles[j * step];
+				std::complex<float> &a = data[i + j], &b = data[i + j + half];
+				float wr = w.real(), wi = w.imag() * sign;
+				float vr = b.real() * wr - b.imag() * wi,
+					  vi = b.real() * wi + b.imag() * wr;
+				b = std::complex<float>(a.real() - vr, a.imag() - vi);
+				a = std::complex<float>(a.real() + vr, a.imag() + vi);
+			}
+		}
+	}
+}
@@ -0,0 +1,27 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex>
+#include <vector>
+
+// Radix-2 fast Fourier transform in place. Plan keeps twiddle factors and
+// bit reversed order for one size, so it is made once and then shared by
+// threads, each transforming own buffer.
+class Fft {
+   public:
+	// Size is power of two, plan is kept when size stays same
+	void plan(int size);
+	int size() const { return n; }
+	void forward(std::complex<float>* data) const;
+	// Includes division by size, so it undoes forward
+	void inverse(std::complex<float>* data) const;
+
+   private:
+	int n = 0;
+	std::vector<int> reversed;
+	std::vector<std::complex<float>> twiddles;	// exp(-2 pi i k / n), k < n/2
+
+	void transform(std::complex<float>* data, bool inverse) const;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+thread_local bool insideJob = false;
+
+class WorkerPool {
+   public:
+	WorkerPool() {
+		unsigned count = std::thread::hardware_concurrency();
+		for (unsigned t = 1; t < count; t++)
+			threads.emplace_back([this]() { this->work(); });
+	}
+	~WorkerPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& t : threads) t.join();
+	}
+
+	void run(size_t count, size_t grain,
+			 const std::function<void(size_t, size_t)>& job) {
+		std::unique_lock<std::mutex> busy(running, std::try_to_lock);
+		if (!busy.owns_lock() || insideJob || threads.empty() ||
+			count <= grain) {
+			job(0, count);
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			current = &job;
+			total = count;
+			chunk = std::max(grain, count / (8 * (threads.size() + 1)));
+			next = 0;
+			pending = threads.size();
+			generation++;
+		}
+		wake.notify_all();
+		process();
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this]() { return pending == 0; });
+		current = NULL;
+	}
+
+	unsigned size() const { return threads.size() + 1; }
+
+   private:
+	std::vector<std::thread> threads;
+	std::mutex running;	 // Held by thread which currently shares work
+	std::mutex mutex;
+	std::condition_variable wake, done;
+	const std::function<void(size_t, size_t)>* current = NULL;
+	std::atomic<size_t> next{0};
+	size_t total = 0, chunk = 1, pending = 0;
+	unsigned long generation = 0;
+	bool stopping = false;
+
+	void process() {
+		insideJob = true;
+		for (size_t begin = next.fetch_add(chunk); begin < total;
+			 begin = next.fetch_add(chunk))
+			(*current)(begin, std::min(begin + chunk, total));
+		insideJob = false;
+	}
+
+	void work() {
+		unsigned long seen = 0;
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			wake.wait(lock,
+					  [&]() { return stopping || generation != seen; });
+			if (stopping) return;
+			seen = generation;
+			lock.unlock();
+			process();
+			lock.lock();
+			if (--pending == 0) done.notify_all();
+		}
+	}
+};
+
+WorkerPool& pool() {
+	static WorkerPool workers;
+	return workers;
+}
+}  // namespace
+
+void parallelFor(size_t count,
+				 const std::function<void(size_t begin, size_t end)>& job,
+				 size_t grain) {
+	if (count == 0) return;
+	pool().run(count, std::max<size_t>(grain, 1), job);
+}
+
+unsigned workerCount() { return pool().size(); }
@@ -0,0 +1,14 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+// Splits range <0, count) into chunks and runs them on shared worker threads.
+// Blocks until every chunk is done. Nested calls run on the calling thread.
+void parallelFor(size_t count,
+				 const std::function<void(size_t begin, size_t end)>& job,
+				 size_t grain = 1);
+unsigned workerCount();	 // Threads taking part in parallelFor (with caller)
+
+#endif
@@ -0,0 +1,34 @@
+#include "texture.hpp"
+
+#include <allegro5/allegro5.h>
+
+#include <cstdint>
+#include <cstring>
+
+Texture::~Texture() {
+	if (bitmap != NULL) al_destroy_bitmap(bitmap);
+}
+
+void Texture::upload(const uint32_t* pixels, int width, int height) {
+	if (width <= 0 || height <= 0) return;
+	if (bitmap == NULL || this->width != width || this->height != height) {
+		if (bitmap != NULL) al_destroy_bitmap(bitmap);
+		int flags = al_get_new_bitmap_flags();
+		al_set_new_bitmap_flags(ALLEGRO_VIDEO_BITMAP | ALLEGRO_MIN_LINEAR |
+								ALLEGRO_MAG_LINEAR);
+		bitmap = al_create_bitmap(width, height);
+		al_set_new_bitmap_flags(flags);
+		this->width = width;
+		this->height = height;
+		if (bitmap == NULL) return;
+	}
+
+	ALLEGRO_LOCKED_REGION* region = al_lock_bitmap(
+		bitmap, ALLEGRO_PIXEL_FORMAT_ARGB_8888, ALLEGRO_LOCK_WRITEONLY);
+	if (region == NULL) return;
+	for (int y = 0; y < height; y++) {
+		std::memcpy((uint8_t*)region->data + y * region->pitch,
+					pixels + (size_t)y * width, width * sizeof(uint32_t));
+	}
+	al_unlock_bitmap(bitmap);
+}
@@ -0,0 +1,27 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <allegro5/allegro5.h>
+#include <imgui.h>
+
+#include <cstdint>
+
+// Allegro bitmap filled from CPU side ARGB buffer, drawable by ImGui.
+class Texture {
+   public:
+	Texture(){};
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+	~Texture();
+
+	// Pixels are 0xAARRGGBB, rows tightly packed, width * height entries.
+	void upload(const uint32_t* pixels, int width, int height);
+	bool empty() const { return bitmap == NULL; }
+	ImTextureID id() const { return (ImTextureID)bitmap; }
+	int width = 0, height = 0;
+
+   private:
+	ALLEGRO_BITMAP* bitmap = NULL;
+};
+
+#endif